@@ -3,18 +3,32 @@
  * -----------------------------------------------------------------------------
  * Purpose:
  *   Heuristic, line-by-line complexity analyzer for C sources that emits a
- *   Markdown report to stdout. It totals LOC, classifies lines (code/comment/
+ *   Markdown (default), JSON Lines or binary columnar report to stdout. It totals LOC, classifies lines (code/comment/
  *   preproc/blank), assigns a complexity score to each code line, and estimates
  *   a simple cyclomatic complexity per function.
  *
  * Usage:
  *   gcc -std=c11 -O2 -Wall -Wextra -o c_complexity c_complexity.c
  *   ./c_complexity your_file.c > complexity-your_file.md
+ *   ./c_complexity --cache .ccache a.c b.c c.c > complexity-src.md
+ *   ./c_complexity --format jsonl a.c b.c > complexity.jsonl
+ *   ./c_complexity --format bin   a.c b.c > complexity.ccb
+ *   ./c_complexity --top 20 --rank score a.c b.c > hotspots.md
+ *   perf script -F +srcline > perf.txt
+ *   ./c_complexity --perf perf.txt --top 20 --rank hot a.c b.c > hot.md
+ *
+ * Incremental Cache (--cache DIR):
+ *   Each file's results are stored under DIR keyed by an XXH64 hash of the
+ *   file contents plus a hash of the scoring knobs. On re-runs, unchanged
+ *   files cost one read + hash; only changed files are re-analyzed. The
+ *   directory must already exist; stale entries can be deleted at any time.
  *
  * Output Sections:
  *   1) Summary (LOC, code/comment/preproc/blank, total & average complexity)
  *   2) Per-function cyclomatic complexity (rough heuristic)
  *   3) Per-line complexity table (first PER_LINE_LIMIT lines)
+ *   The jsonl/bin formats carry the same data as records/columns (all lines);
+ *   their layouts are documented next to emit_jsonl() and emit_binary().
  *
  * Philosophy:
  *   - NOT a full C parser; it is a robust heuristic useful for spotting hot
@@ -28,7 +42,14 @@
  *     implicit declaration warnings even on older libcs or stricter headers.
  *
  * Tuning Knobs (search for "WEIGHT_" and "PER_LINE_LIMIT"):
- *   - You can adjust scoring weights and the per-line output cap.
+ *   - The macros are only defaults. Weights can be changed per run with a
+ *     profile file or --weight flags, and the per-line cap with
+ *     --per-line-limit; no rebuild is needed. A profile file looks like:
+ *         name     = strict
+ *         ctrl     = 2        # base ctrl ternary logical incdec
+ *         call_cap = 5        # call_per call_cap depth_min
+ *   - Passing several --profile options scores every line under each of
+ *     them in the same pass, for A/B comparison of the totals.
  */
 
 #define _POSIX_C_SOURCE 200809L  /* Request POSIX interfaces (e.g., strdup, strnlen) */
@@ -37,7 +58,10 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <errno.h>
+#include <limits.h>
 #include <stdint.h>
+#include <unistd.h>
 
 /* --------------------------------------------------------------------------
  * Global Configuration (tuning knobs)
@@ -103,6 +127,8 @@ typedef struct {
     int   start_line;  /* inclusive */
     int   end_line;    /* inclusive */
     int   cyclomatic;  /* heuristic cyclomatic complexity */
+    int   score_sum;   /* summed line scores inside the function (profile 0) */
+    long long samples; /* self samples from --perf (never cached, set per run) */
 } FuncReport;
 
 /* --------------------------------------------------------------------------
@@ -134,35 +160,6 @@ static int is_ident_char(int c) {
     return isalnum(c) || c == '_';
 }
 
-/* Check that s[start..end-1] is a whole word, not part of a larger identifier */
-static int is_word_boundary(const char* s, int start, int end) {
-    if (start > 0 && is_ident_char((unsigned char)s[start - 1])) return 0;
-    if (s[end] && is_ident_char((unsigned char)s[end])) return 0;
-    return 1;
-}
-
-/* Count occurrences of a whole word (e.g., "if") with identifier boundaries */
-static int count_word(const char* s, const char* word) {
-    int n = 0;
-    int len = (int)strlen(word);
-    for (int i = 0; s[i]; ++i) {
-        if (!strncmp(&s[i], word, len)) {
-            if (is_word_boundary(s, i, i + len)) n++;
-        }
-    }
-    return n;
-}
-
-/* Count raw substring occurrences (e.g., "&&", "||") */
-static int count_substr(const char* s, const char* pat) {
-    int n = 0, len = (int)strlen(pat);
-    if (len == 0) return 0;
-    for (int i = 0; s[i]; ++i) {
-        if (!strncmp(&s[i], pat, len)) n++;
-    }
-    return n;
-}
-
 /* Mask out string and char literals to avoid counting tokens inside them.
    Replaces their contents with spaces so indexing and other tokens remain aligned. */
 static void strip_strings(const char* in, char* out, size_t outsz) {
@@ -269,133 +266,397 @@ static void extract_func_name(const char* line, char out[128]) {
 }
 
 /* --------------------------------------------------------------------------
- * Flag management for per-line explanations
+ * Scoring profiles (runtime-configurable weights)
+ *
+ * The WEIGHT_* macros only provide defaults. A profile can be loaded from a
+ * "key = value" file (--profile FILE) or tweaked with --weight key=value.
+ * Several profiles may be active at once; every line is scanned once and
+ * then scored under each of them (profile 0 drives the per-line tables).
  * -------------------------------------------------------------------------- */
 
-static void append_flag(char** flags, const char* add) {
-    if (!add || !*add) return;
-    size_t old = (*flags) ? strlen(*flags) : 0;
-    size_t addlen = strlen(add);
-    size_t newcap = old + addlen + (old ? 2 : 1); /* +1 for comma +1 for '\0' */
-    char* buf = (char*)realloc(*flags, newcap);
-    if (!buf) return; /* OOM: silently ignore flag growth to avoid crashing */
-    *flags = buf;
-    if (old == 0) {
-        strcpy(*flags, add);
-    } else {
-        (*flags)[old] = ',';
-        strcpy((*flags) + old + 1, add);
+/* Token classes reported by the scanner; a line's linear score is the dot
+   product of its class counts with the profile's weight table. */
+typedef enum {
+    TK_BASE = 0,
+    TK_ELSE, TK_IF, TK_FOR, TK_WHILE, TK_SWITCH, TK_CASE, TK_DEFAULT, TK_GOTO,
+    TK_TERNARY, TK_LAND, TK_LOR, TK_INC, TK_DEC,
+    TK_COUNT
+} TokClass;
+
+/* Flag text for each class, in the order flags are reported */
+static const char* const TK_FLAG[TK_COUNT] = {
+    "", "else", "if", "for", "while", "switch", "case", "default", "goto",
+    "?:", "&&", "||", "++", "--"
+};
+
+#ifndef MAX_PROFILES
+#define MAX_PROFILES 8
+#endif
+
+typedef struct {
+    char name[32];
+    /* knobs, same meaning as the WEIGHT_* macros */
+    int  base, ctrl, ternary, logical, incdec, call_per, call_cap, depth_min;
+    /* specialized weight table, filled by profile_compile() */
+    int  w[TK_COUNT];
+} Profile;
+
+static Profile g_profiles[MAX_PROFILES];
+static int     g_nprofiles = 0;
+static int     g_per_line_limit = PER_LINE_LIMIT;
+
+static void profile_defaults(Profile* pr, const char* name) {
+    memset(pr, 0, sizeof(*pr));
+    snprintf(pr->name, sizeof(pr->name), "%s", name);
+    pr->base      = WEIGHT_BASE;
+    pr->ctrl      = WEIGHT_CTRL;
+    pr->ternary   = WEIGHT_TERNARY;
+    pr->logical   = WEIGHT_LOGICAL;
+    pr->incdec    = WEIGHT_INCDEC;
+    pr->call_per  = WEIGHT_CALL_PER;
+    pr->call_cap  = WEIGHT_CALL_CAP;
+    pr->depth_min = WEIGHT_DEPTH_MIN;
+}
+
+/* Expand the knobs into a per-token-class table once, at load time */
+static void profile_compile(Profile* pr) {
+    pr->w[TK_BASE] = pr->base;
+    for (int k = TK_ELSE; k <= TK_GOTO; k++) pr->w[k] = pr->ctrl;
+    pr->w[TK_TERNARY] = pr->ternary;
+    pr->w[TK_LAND] = pr->w[TK_LOR] = pr->logical;
+    pr->w[TK_INC]  = pr->w[TK_DEC] = pr->incdec;
+}
+
+/* Set one knob by name. Returns 0 on success, -1 for an unknown key or a
+ * value that is not a whole int. */
+static int profile_set(Profile* pr, const char* key, const char* val) {
+    struct { const char* key; int* field; } knobs[] = {
+        { "base", &pr->base }, { "ctrl", &pr->ctrl }, { "ternary", &pr->ternary },
+        { "logical", &pr->logical }, { "incdec", &pr->incdec },
+        { "call_per", &pr->call_per }, { "call_cap", &pr->call_cap },
+        { "depth_min", &pr->depth_min }
+    };
+    if (!strcmp(key, "name")) {
+        snprintf(pr->name, sizeof(pr->name), "%s", val);
+        return 0;
     }
+    for (size_t i = 0; i < sizeof(knobs)/sizeof(knobs[0]); ++i) {
+        if (!strcmp(key, knobs[i].key)) {
+            char* end;
+            errno = 0;
+            long v = strtol(val, &end, 10);
+            if (end == val || *end || errno == ERANGE || v < INT_MIN || v > INT_MAX) return -1;
+            *knobs[i].field = (int)v;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/* Split "key=value" / "key = value" in place; returns 0 if well-formed */
+static int split_assignment(char* s, char** key, char** val) {
+    char* eq = strchr(s, '=');
+    if (!eq) return -1;
+    *eq = '\0';
+    char* k = s;
+    char* v = eq + 1;
+    while (isspace((unsigned char)*k)) k++;
+    while (isspace((unsigned char)*v)) v++;
+    for (char* e = eq - 1; e >= k && isspace((unsigned char)*e); --e) *e = '\0';
+    for (char* e = v + strlen(v) - 1; e >= v && isspace((unsigned char)*e); --e) *e = '\0';
+    *key = k; *val = v;
+    return *k ? 0 : -1;
+}
+
+/* Load a profile file: "key = value" lines, '#' starts a comment.
+   The name defaults to the file path. Returns 0 on success. */
+static int profile_load(Profile* pr, const char* path) {
+    profile_defaults(pr, path);
+    FILE* f = fopen(path, "r");
+    if (!f) { perror(path); return -1; }
+
+    char line[256];
+    int lineno = 0, rc = 0;
+    while (fgets(line, sizeof(line), f)) {
+        lineno++;
+        char* hash = strchr(line, '#');
+        if (hash) *hash = '\0';
+        char* s = line;
+        while (isspace((unsigned char)*s)) s++;
+        if (!*s) continue;
+
+        char *key, *val;
+        if (split_assignment(s, &key, &val) != 0 || profile_set(pr, key, val) != 0) {
+            fprintf(stderr, "%s:%d: bad profile entry\n", path, lineno);
+            rc = -1;
+        }
+    }
+    fclose(f);
+    return rc;
 }
 
 /* --------------------------------------------------------------------------
- * Per-line scoring function (heuristic)
+ * Per-line scanning and scoring (heuristic)
  * -------------------------------------------------------------------------- */
 
-static int score_line(const char* raw, int depth, char** flags_out) {
-    char* flags = NULL;
-    int score = 0;
-
-    if (!raw || !*raw) {
-        append_flag(&flags, "blank");
-        *flags_out = flags;
-        return 0;
+/* Map a whole identifier to its keyword class, or TK_COUNT if not a keyword */
+static TokClass keyword_class(const char* s, size_t n) {
+    switch (n) {
+        case 2:
+            if (!memcmp(s, "if", 2)) return TK_IF;
+            break;
+        case 3:
+            if (!memcmp(s, "for", 3)) return TK_FOR;
+            break;
+        case 4:
+            if (!memcmp(s, "else", 4)) return TK_ELSE;
+            if (!memcmp(s, "case", 4)) return TK_CASE;
+            if (!memcmp(s, "goto", 4)) return TK_GOTO;
+            break;
+        case 5:
+            if (!memcmp(s, "while", 5)) return TK_WHILE;
+            break;
+        case 6:
+            if (!memcmp(s, "switch", 6)) return TK_SWITCH;
+            break;
+        case 7:
+            if (!memcmp(s, "default", 7)) return TK_DEFAULT;
+            break;
     }
+    return TK_COUNT;
+}
 
-    /* Base score: each code line "costs" at least this much */
-    score += WEIGHT_BASE;
-
-    /* Operate on a version with literals blanked out to avoid false positives */
-    char tmp[LINE_MAX_CHARS];
-    strip_strings(raw, tmp, sizeof(tmp));
-
-    /* Control keywords: else, if/for/while/switch/case/default/goto */
-    int h = 0;
-    h = count_word(tmp, "else");
-    if (h) { score += h * WEIGHT_CTRL; append_flag(&flags, "else"); }
-
-    const char* ctrls[] = {"if","for","while","switch","case","default","goto"};
-    for (size_t i = 0; i < sizeof(ctrls)/sizeof(ctrls[0]); ++i) {
-        int c = count_word(tmp, ctrls[i]);
-        if (c) { score += c * WEIGHT_CTRL; append_flag(&flags, ctrls[i]); }
-    }
-
-    /* Ternary ?: (very rough presence detection) */
-    if (strchr(tmp, '?') && strchr(tmp, ':')) {
-        score += WEIGHT_TERNARY;
-        append_flag(&flags, "?:");
-    }
-
-    /* Logical operators */
-    int land = count_substr(tmp, "&&");
-    int lor  = count_substr(tmp, "||");
-    if (land) { score += land * WEIGHT_LOGICAL; append_flag(&flags, "&&"); }
-    if (lor)  { score += lor  * WEIGHT_LOGICAL; append_flag(&flags, "||"); }
-
-    /* Increment/decrement operators */
-    int inc = count_substr(tmp, "++");
-    int dec = count_substr(tmp, "--");
-    if (inc) { score += inc * WEIGHT_INCDEC; append_flag(&flags, "++"); }
-    if (dec) { score += dec * WEIGHT_INCDEC; append_flag(&flags, "--"); }
-
-    /* Function calls (cap contribution per line to avoid runaway) */
-    int calls = 0;
-    for (const char* p = tmp; (p = strchr(p, '(')); ++p) {
-        /* Identify token before '(' */
-        const char* q = p - 1;
-        while (q >= tmp && (isspace((unsigned char)*q) || *q == '*')) q--;
-        const char* end = q;
-        while (q >= tmp && is_ident_char((unsigned char)*q)) q--;
-        int len = (int)(end - (q + 1) + 1);
-        if (len > 0 && len < 64) {
-            char name[64]; memcpy(name, q + 1, (size_t)len); name[len] = '\0';
-            if (!is_control_name(name) && strcmp(name, "return") && strcmp(name, "sizeof")) {
-                calls++;
-            }
+/* Single pass over a line with literals blanked out. Counts each token
+   class into feat[] and returns the number of call-like "name(" sites. */
+static int scan_features(const char* s, int feat[TK_COUNT]) {
+    int calls = 0, has_q = 0, has_colon = 0;
+    const char* ident = NULL;   /* identifier a following '(' would call */
+    size_t ident_len = 0;
+
+    memset(feat, 0, TK_COUNT * sizeof(feat[0]));
+    feat[TK_BASE] = 1;
+
+    const char* p = s;
+    while (*p) {
+        unsigned char c = (unsigned char)*p;
+        if (is_ident_char(c)) {
+            const char* start = p;
+            while (*p && is_ident_char((unsigned char)*p)) p++;
+            ident = start;
+            ident_len = (size_t)(p - start);
+            TokClass k = keyword_class(start, ident_len);
+            if (k != TK_COUNT) feat[k]++;
+            continue;
+        }
+        switch (c) {
+            case '(':
+                if (ident && ident_len < 64) {
+                    char name[64];
+                    memcpy(name, ident, ident_len);
+                    name[ident_len] = '\0';
+                    if (!is_control_name(name)) calls++;
+                }
+                ident = NULL;
+                break;
+            case '*':
+                break;  /* "name *(" still counts as a call, as before */
+            case '?': has_q = 1;     ident = NULL; break;
+            case ':': has_colon = 1; ident = NULL; break;
+            case '&': if (p[1] == '&') feat[TK_LAND]++; ident = NULL; break;
+            case '|': if (p[1] == '|') feat[TK_LOR]++;  ident = NULL; break;
+            case '+': if (p[1] == '+') feat[TK_INC]++;  ident = NULL; break;
+            case '-': if (p[1] == '-') feat[TK_DEC]++;  ident = NULL; break;
+            default:
+                if (!isspace(c)) ident = NULL;
+                break;
         }
+        p++;
     }
+    if (has_q && has_colon) feat[TK_TERNARY] = 1;
+    return calls;
+}
+
+/* Score one scanned line under a compiled profile: one multiply-add per
+   token class, plus the capped call term and the nesting penalty. */
+static int score_features(const Profile* pr, const int feat[TK_COUNT], int calls, int depth) {
+    int score = 0;
+    for (int k = 0; k < TK_COUNT; k++) score += feat[k] * pr->w[k];
+
     if (calls > 0) {
-        int add = calls * WEIGHT_CALL_PER;
-        if (add > WEIGHT_CALL_CAP) add = WEIGHT_CALL_CAP;
+        int add = calls * pr->call_per;
+        if (add > pr->call_cap) add = pr->call_cap;
         score += add;
-
-        char note[32];
-        snprintf(note, sizeof(note), "calls:%d", calls);
-        append_flag(&flags, note);
     }
-
-    /* Nesting depth penalty: encourages flatter code */
     if (depth > 0) {
         int add = depth / 2;
-        if (add < WEIGHT_DEPTH_MIN) add = WEIGHT_DEPTH_MIN;
+        if (add < pr->depth_min) add = pr->depth_min;
         score += add;
+    }
+    return score;
+}
 
-        char note[32];
-        snprintf(note, sizeof(note), "depth:%d", depth);
-        append_flag(&flags, note);
+/* Comma-separated tags explaining score sources (independent of weights) */
+static char* format_flags(const int feat[TK_COUNT], int calls, int depth) {
+    char buf[256];
+    size_t w = 0;
+    for (int k = TK_ELSE; k < TK_COUNT; k++) {
+        if (!feat[k]) continue;
+        w += (size_t)snprintf(buf + w, sizeof(buf) - w, "%s%s", w ? "," : "", TK_FLAG[k]);
     }
+    if (calls > 0) w += (size_t)snprintf(buf + w, sizeof(buf) - w, "%scalls:%d", w ? "," : "", calls);
+    if (depth > 0) w += (size_t)snprintf(buf + w, sizeof(buf) - w, "%sdepth:%d", w ? "," : "", depth);
+    return w ? my_strdup(buf) : NULL;
+}
 
-    *flags_out = flags;
-    return score;
+/* --------------------------------------------------------------------------
+ * Content hashing (XXH64, built in so there is no external dependency)
+ * -------------------------------------------------------------------------- */
+
+#define XXH_P1 11400714785074694791ULL
+#define XXH_P2 14029467366897019727ULL
+#define XXH_P3  1609587929392839161ULL
+#define XXH_P4  9650029242287828579ULL
+#define XXH_P5  2870177450012600261ULL
+
+static uint64_t xxh_rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+static uint64_t xxh_read64(const unsigned char* p) { uint64_t v; memcpy(&v, p, 8); return v; }
+static uint32_t xxh_read32(const unsigned char* p) { uint32_t v; memcpy(&v, p, 4); return v; }
+
+static uint64_t xxh_round(uint64_t acc, uint64_t in) {
+    acc += in * XXH_P2;
+    acc  = xxh_rotl(acc, 31);
+    return acc * XXH_P1;
+}
+
+static uint64_t xxh_merge(uint64_t acc, uint64_t v) {
+    acc ^= xxh_round(0, v);
+    return acc * XXH_P1 + XXH_P4;
+}
+
+/* xxh64: 64-bit hash of len bytes. Streams 32-byte stripes through four
+   independent accumulators, so it runs at memory bandwidth on large files. */
+static uint64_t xxh64(const void* data, size_t len, uint64_t seed) {
+    const unsigned char* p   = (const unsigned char*)data;
+    const unsigned char* end = p + len;
+    uint64_t h;
+
+    if (len >= 32) {
+        const unsigned char* limit = end - 32;
+        uint64_t v1 = seed + XXH_P1 + XXH_P2;
+        uint64_t v2 = seed + XXH_P2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - XXH_P1;
+        do {
+            v1 = xxh_round(v1, xxh_read64(p));      p += 8;
+            v2 = xxh_round(v2, xxh_read64(p));      p += 8;
+            v3 = xxh_round(v3, xxh_read64(p));      p += 8;
+            v4 = xxh_round(v4, xxh_read64(p));      p += 8;
+        } while (p <= limit);
+        h = xxh_rotl(v1, 1) + xxh_rotl(v2, 7) + xxh_rotl(v3, 12) + xxh_rotl(v4, 18);
+        h = xxh_merge(h, v1);
+        h = xxh_merge(h, v2);
+        h = xxh_merge(h, v3);
+        h = xxh_merge(h, v4);
+    } else {
+        h = seed + XXH_P5;
+    }
+
+    h += (uint64_t)len;
+    while (p + 8 <= end) {
+        h ^= xxh_round(0, xxh_read64(p));
+        h  = xxh_rotl(h, 27) * XXH_P1 + XXH_P4;
+        p += 8;
+    }
+    if (p + 4 <= end) {
+        h ^= (uint64_t)xxh_read32(p) * XXH_P1;
+        h  = xxh_rotl(h, 23) * XXH_P2 + XXH_P3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= (uint64_t)(*p) * XXH_P5;
+        h  = xxh_rotl(h, 11) * XXH_P1;
+        p++;
+    }
+
+    h ^= h >> 33; h *= XXH_P2;
+    h ^= h >> 29; h *= XXH_P3;
+    h ^= h >> 32;
+    return h;
 }
 
 /* --------------------------------------------------------------------------
- * Main analysis routine
+ * Per-file analysis result
  * -------------------------------------------------------------------------- */
 
-int main(int argc, char** argv) {
-    if (argc < 2) {
-        fprintf(stderr, "Usage: %s <file.c> > report.md\n", argv[0]);
-        return 1;
+typedef struct {
+    int         total_lines;
+    int         code_cnt, comment_cnt, preproc_cnt, blank_cnt;
+    int         total_score;                  /* under profile 0 */
+    int         profile_totals[MAX_PROFILES]; /* [0] mirrors total_score */
+    LineReport* lines;   size_t lines_len;
+    FuncReport* funcs;   size_t funcs_len;
+} FileReport;
+
+static void free_file_report(FileReport* fr) {
+    for (size_t i = 0; i < fr->lines_len; i++) {
+        free(fr->lines[i].flags);
+        free(fr->lines[i].text);
     }
+    free(fr->lines);
+    free(fr->funcs);
+    memset(fr, 0, sizeof(*fr));
+}
 
-    const char* path = argv[1];
-    FILE* f = fopen(path, "r");
-    if (!f) {
-        perror("fopen");
-        return 1;
+/* Read a whole file into a malloc'd buffer (so it can be hashed and then
+   analyzed without a second read). Returns 0 on success, -1 on error. */
+static int read_file(const char* path, char** out, size_t* out_len) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return -1;
+
+    size_t cap = 64 * 1024, len = 0;
+    char* buf = (char*)malloc(cap);
+    if (!buf) { fclose(f); return -1; }
+
+    for (;;) {
+        if (len == cap) {
+            char* tmp = (char*)realloc(buf, cap * 2);
+            if (!tmp) { free(buf); fclose(f); return -1; }
+            buf = tmp; cap *= 2;
+        }
+        size_t n = fread(buf + len, 1, cap - len, f);
+        len += n;
+        if (n == 0) break;
     }
+    int err = ferror(f);
+    fclose(f);
+    if (err) { free(buf); return -1; }
+
+    *out = buf;
+    *out_len = len;
+    return 0;
+}
+
+/* Copy the next line of buf into line[], splitting over-long lines exactly
+   like fgets(line, linesz, f) would. Returns 0 at end of input. */
+static int next_line(const char* buf, size_t len, size_t* pos, char* line, size_t linesz) {
+    if (*pos >= len) return 0;
+    size_t n = 0;
+    while (*pos < len && n + 1 < linesz) {
+        char c = buf[(*pos)++];
+        line[n++] = c;
+        if (c == '\n') break;
+    }
+    line[n] = '\0';
+    return 1;
+}
+
+/* --------------------------------------------------------------------------
+ * Main analysis routine
+ * Returns 0 on success, 2/3 on out-of-memory (matching the old exit codes).
+ * -------------------------------------------------------------------------- */
 
+static int analyze_buffer(const char* buf, size_t buf_len, FileReport* fr) {
     LineReport* lines = NULL;
     size_t lines_cap = 0, lines_len = 0;
 
@@ -408,11 +669,16 @@ int main(int argc, char** argv) {
 
     int lineno = 0;
     int in_func = 0;
+    int rc = 0;
     FuncReport current;
     memset(&current, 0, sizeof(current));
 
+    memset(fr, 0, sizeof(*fr));
+    g_in_block_comment = 0;  /* comment state must not leak between files */
+
     char line[LINE_MAX_CHARS];
-    while (fgets(line, sizeof(line), f)) {
+    size_t pos = 0;
+    while (next_line(buf, buf_len, &pos, line, sizeof(line))) {
         lineno++;
 
         /* Classify current line BEFORE brace updates */
@@ -456,7 +722,7 @@ int main(int argc, char** argv) {
         if (lines_len == lines_cap) {
             size_t newcap = (lines_cap == 0) ? 512 : (lines_cap * 2);
             LineReport* tmp = (LineReport*)realloc(lines, newcap * sizeof(LineReport));
-            if (!tmp) { fprintf(stderr, "Out of memory\n"); fclose(f); return 2; }
+            if (!tmp) { fprintf(stderr, "Out of memory\n"); rc = 2; goto oom; }
             lines = tmp; lines_cap = newcap;
         }
 
@@ -473,21 +739,29 @@ int main(int argc, char** argv) {
         snprintf(preview, sizeof(preview), "%.*s", PREVIEW_CHARS, s);
 
         if (kind == L_CODE) {
-            lr->score = score_line(line, depth, &lr->flags);
+            /* Operate on a version with literals blanked out to avoid false positives */
+            char stripped[LINE_MAX_CHARS];
+            int feat[TK_COUNT];
+            strip_strings(line, stripped, sizeof(stripped));
+            int calls = scan_features(stripped, feat);
+
+            lr->score = score_features(&g_profiles[0], feat, calls, depth);
+            lr->flags = format_flags(feat, calls, depth);
             total_score += lr->score;
+            if (in_func) current.score_sum += lr->score;
+            for (int pi = 1; pi < g_nprofiles; pi++)
+                fr->profile_totals[pi] += score_features(&g_profiles[pi], feat, calls, depth);
 
             /* Cyclomatic bumps inside a function */
             if (in_func) {
-                char stripped[LINE_MAX_CHARS];
-                strip_strings(line, stripped, sizeof(stripped));
-                if (count_word(stripped, "if"))      current.cyclomatic++;
-                if (count_word(stripped, "for"))     current.cyclomatic++;
-                if (count_word(stripped, "while"))   current.cyclomatic++;
-                if (count_word(stripped, "case"))    current.cyclomatic++;
-                if (count_word(stripped, "default")) current.cyclomatic++;
-                if (strchr(stripped, '?') && strchr(stripped, ':')) current.cyclomatic++;
-                current.cyclomatic += count_substr(stripped, "&&");
-                current.cyclomatic += count_substr(stripped, "||");
+                if (feat[TK_IF])      current.cyclomatic++;
+                if (feat[TK_FOR])     current.cyclomatic++;
+                if (feat[TK_WHILE])   current.cyclomatic++;
+                if (feat[TK_CASE])    current.cyclomatic++;
+                if (feat[TK_DEFAULT]) current.cyclomatic++;
+                if (feat[TK_TERNARY]) current.cyclomatic++;
+                current.cyclomatic += feat[TK_LAND];
+                current.cyclomatic += feat[TK_LOR];
             }
 
             lr->text = my_strdup(preview);
@@ -511,7 +785,7 @@ int main(int argc, char** argv) {
             if (funcs_len == funcs_cap) {
                 size_t newcap = (funcs_cap == 0) ? 64 : (funcs_cap * 2);
                 FuncReport* tmp = (FuncReport*)realloc(funcs, newcap * sizeof(FuncReport));
-                if (!tmp) { fprintf(stderr, "Out of memory\n"); fclose(f); return 3; }
+                if (!tmp) { fprintf(stderr, "Out of memory\n"); rc = 3; goto oom; }
                 funcs = tmp; funcs_cap = newcap;
             }
             funcs[funcs_len++] = current;
@@ -521,38 +795,419 @@ int main(int argc, char** argv) {
         }
     }
 
+    fr->total_lines = lineno;
+    fr->code_cnt    = code_cnt;
+    fr->comment_cnt = comment_cnt;
+    fr->preproc_cnt = preproc_cnt;
+    fr->blank_cnt   = blank_cnt;
+    fr->total_score = total_score;
+    fr->profile_totals[0] = total_score;
+    fr->lines = lines;  fr->lines_len = lines_len;
+    fr->funcs = funcs;  fr->funcs_len = funcs_len;
+    return 0;
+
+oom:
+    fr->lines = lines;  fr->lines_len = lines_len;
+    fr->funcs = funcs;  fr->funcs_len = funcs_len;
+    free_file_report(fr);
+    return rc;
+}
+
+/* --------------------------------------------------------------------------
+ * Incremental re-analysis cache
+ *
+ * One file per analyzed source in the cache directory, named
+ *   <content-hash><config-hash>.ccx   (both as 16 hex digits)
+ * so a hit proves both the bytes and the scoring knobs are unchanged, and a
+ * hit skips analysis entirely. Entries are written to a temp name and then
+ * renamed into place, so concurrent runs never observe a half-written entry.
+ *
+ * Record layout (native endianness; the cache is local to one machine):
+ *   "CCX1" u64 content_hash u64 config_hash
+ *   i32 total_lines code comment preproc blank total_score
+ *   i32 profile_totals[nprofiles]   (nprofiles is part of the config hash)
+ *   u64 funcs_len u64 lines_len
+ *   FuncReport[funcs_len]
+ *   per line: i32 lineno depth score, u32 len + flags bytes, u32 len + text bytes
+ * -------------------------------------------------------------------------- */
+
+/* Bump whenever analysis output or the record layout changes */
+#define CACHE_FORMAT_VERSION 4
+
+static const char CACHE_MAGIC[4] = { 'C', 'C', 'X', '1' };
+
+/* Hash of everything that changes analysis output besides the file bytes:
+   limits, record layout and the knobs of every active profile, in order. */
+static uint64_t config_hash(void) {
+    const int64_t fixed[] = {
+        CACHE_FORMAT_VERSION, (int64_t)sizeof(FuncReport),
+        LINE_MAX_CHARS, PREVIEW_CHARS, g_nprofiles
+    };
+    uint64_t h = xxh64(fixed, sizeof(fixed), 0);
+    for (int i = 0; i < g_nprofiles; i++) {
+        const Profile* pr = &g_profiles[i];
+        const int knobs[] = { pr->base, pr->ctrl, pr->ternary, pr->logical,
+                              pr->incdec, pr->call_per, pr->call_cap, pr->depth_min };
+        h = xxh64(knobs, sizeof(knobs), h);
+    }
+    return h;
+}
+
+static void cache_entry_path(const char* dir, uint64_t chash, uint64_t cfg, char* out, size_t n) {
+    snprintf(out, n, "%s/%016llx%016llx.ccx", dir,
+             (unsigned long long)chash, (unsigned long long)cfg);
+}
+
+static int cache_write_str(FILE* f, const char* s) {
+    uint32_t n = s ? (uint32_t)strlen(s) : 0;
+    if (fwrite(&n, sizeof(n), 1, f) != 1) return -1;
+    if (n && fwrite(s, 1, n, f) != n) return -1;
+    return 0;
+}
+
+static char* cache_read_str(FILE* f) {
+    uint32_t n;
+    if (fread(&n, sizeof(n), 1, f) != 1 || n > LINE_MAX_CHARS) return NULL;
+    char* s = (char*)malloc((size_t)n + 1);
+    if (!s) return NULL;
+    if (n && fread(s, 1, n, f) != n) { free(s); return NULL; }
+    s[n] = '\0';
+    return s;
+}
+
+/* Load a cache entry. Returns 0 on hit; any mismatch or damage is a miss. */
+static int cache_load(const char* path, uint64_t chash, uint64_t cfg, FileReport* fr) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return -1;
+
+    memset(fr, 0, sizeof(*fr));
+    char magic[4];
+    uint64_t h[2], n[2];
+    int32_t hdr[6];
+    if (fread(magic, 1, 4, f) != 4 || memcmp(magic, CACHE_MAGIC, 4) != 0 ||
+        fread(h, sizeof(h[0]), 2, f) != 2 || h[0] != chash || h[1] != cfg ||
+        fread(hdr, sizeof(hdr[0]), 6, f) != 6 ||
+        fread(fr->profile_totals, sizeof(int), (size_t)g_nprofiles, f) != (size_t)g_nprofiles ||
+        fread(n, sizeof(n[0]), 2, f) != 2) {
+        fclose(f);
+        return -1;
+    }
+    fr->total_lines = hdr[0]; fr->code_cnt = hdr[1]; fr->comment_cnt = hdr[2];
+    fr->preproc_cnt = hdr[3]; fr->blank_cnt = hdr[4]; fr->total_score = hdr[5];
+
+    if (n[0]) {
+        fr->funcs = (FuncReport*)malloc((size_t)n[0] * sizeof(FuncReport));
+        if (!fr->funcs || fread(fr->funcs, sizeof(FuncReport), (size_t)n[0], f) != n[0]) goto miss;
+        fr->funcs_len = (size_t)n[0];
+    }
+    if (n[1]) {
+        fr->lines = (LineReport*)calloc((size_t)n[1], sizeof(LineReport));
+        if (!fr->lines) goto miss;
+        for (size_t i = 0; i < n[1]; i++) {
+            LineReport* lr = &fr->lines[i];
+            int32_t v[3];
+            if (fread(v, sizeof(v[0]), 3, f) != 3) goto miss;
+            fr->lines_len = i + 1;
+            lr->lineno = v[0]; lr->depth = v[1]; lr->score = v[2];
+            lr->flags = cache_read_str(f);
+            lr->text  = cache_read_str(f);
+            if (!lr->flags || !lr->text) goto miss;
+        }
+    }
+    fclose(f);
+    return 0;
+
+miss:
+    fclose(f);
+    free_file_report(fr);
+    return -1;
+}
+
+/* Store a cache entry; failures are silently ignored (the cache is optional). */
+static void cache_store(const char* path, uint64_t chash, uint64_t cfg, const FileReport* fr) {
+    char tmp_path[4200];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp%ld", path, (long)getpid());
+    FILE* f = fopen(tmp_path, "wb");
+    if (!f) return;
+
+    uint64_t h[2] = { chash, cfg };
+    uint64_t n[2] = { fr->funcs_len, fr->lines_len };
+    int32_t hdr[6] = { fr->total_lines, fr->code_cnt, fr->comment_cnt,
+                       fr->preproc_cnt, fr->blank_cnt, fr->total_score };
+    int bad = fwrite(CACHE_MAGIC, 1, 4, f) != 4 ||
+              fwrite(h, sizeof(h[0]), 2, f) != 2 ||
+              fwrite(hdr, sizeof(hdr[0]), 6, f) != 6 ||
+              fwrite(fr->profile_totals, sizeof(int), (size_t)g_nprofiles, f) != (size_t)g_nprofiles ||
+              fwrite(n, sizeof(n[0]), 2, f) != 2 ||
+              (fr->funcs_len && fwrite(fr->funcs, sizeof(FuncReport), fr->funcs_len, f) != fr->funcs_len);
+    for (size_t i = 0; !bad && i < fr->lines_len; i++) {
+        const LineReport* lr = &fr->lines[i];
+        int32_t v[3] = { lr->lineno, lr->depth, lr->score };
+        bad = fwrite(v, sizeof(v[0]), 3, f) != 3 ||
+              cache_write_str(f, lr->flags) != 0 ||
+              cache_write_str(f, lr->text) != 0;
+    }
+    if (fclose(f) != 0) bad = 1;
+
+    if (bad || rename(tmp_path, path) != 0) remove(tmp_path);
+}
+
+/* --------------------------------------------------------------------------
+ * Profile sample join (--perf FILE)
+ *
+ * Streams a `perf script` dump or a folded-stack file (stackcollapse output,
+ * "a;b;leaf 42") once, line by line, and aggregates self samples of each
+ * leaf frame into two hash maps:
+ *   - by symbol name ("draw_table"), and
+ *   - by "<basename>:<line>" when the dump carries srclines
+ *     (perf script -F +srcline), which separates same-named static functions.
+ * Memory is bounded by the number of distinct symbols/lines, not samples.
+ * FuncReports then pick up their sample count by line range when srcline
+ * data matched, otherwise by name.
+ * -------------------------------------------------------------------------- */
+
+typedef struct {
+    char*     key;      /* NULL = empty slot */
+    uint64_t  hash;
+    long long samples;
+} PerfSlot;
+
+typedef struct {
+    PerfSlot* slots;
+    size_t    cap;      /* power of two */
+    size_t    len;
+} PerfMap;
+
+static PerfMap   g_perf_syms, g_perf_lines;
+static long long g_perf_total = 0;   /* all samples seen, for CPU share */
+
+static PerfSlot* perfmap_find(const PerfMap* m, const char* key, size_t n, uint64_t h) {
+    if (!m->cap) return NULL;
+    for (size_t i = (size_t)h & (m->cap - 1);; i = (i + 1) & (m->cap - 1)) {
+        PerfSlot* s = &m->slots[i];
+        if (!s->key) return s;
+        if (s->hash == h && !strncmp(s->key, key, n) && s->key[n] == '\0') return s;
+    }
+}
+
+static int perfmap_grow(PerfMap* m) {
+    size_t ncap = m->cap ? m->cap * 2 : 1024;
+    PerfSlot* ns = (PerfSlot*)calloc(ncap, sizeof(PerfSlot));
+    if (!ns) return -1;
+    PerfMap nm = { ns, ncap, m->len };
+    for (size_t i = 0; i < m->cap; i++) {
+        if (m->slots[i].key) *perfmap_find(&nm, m->slots[i].key, strlen(m->slots[i].key), m->slots[i].hash) = m->slots[i];
+    }
+    free(m->slots);
+    *m = nm;
+    return 0;
+}
+
+static int perfmap_add(PerfMap* m, const char* key, size_t n, long long samples) {
+    if ((m->len + 1) * 10 > m->cap * 7 && perfmap_grow(m) != 0) return -1;
+    uint64_t h = xxh64(key, n, 0);
+    PerfSlot* s = perfmap_find(m, key, n, h);
+    if (!s->key) {
+        s->key = (char*)malloc(n + 1);
+        if (!s->key) return -1;
+        memcpy(s->key, key, n);
+        s->key[n] = '\0';
+        s->hash = h;
+        m->len++;
+    }
+    s->samples += samples;
+    return 0;
+}
+
+static long long perfmap_get(const PerfMap* m, const char* key, size_t n) {
+    const PerfSlot* s = perfmap_find(m, key, n, xxh64(key, n, 0));
+    return (s && s->key) ? s->samples : 0;
+}
+
+static void perfmap_free(PerfMap* m) {
+    for (size_t i = 0; i < m->cap; i++) free(m->slots[i].key);
+    free(m->slots);
+    memset(m, 0, sizeof(*m));
+}
+
+static const char* path_basename(const char* p) {
+    const char* slash = strrchr(p, '/');
+    return slash ? slash + 1 : p;
+}
+
+/* Record one leaf frame: "sym+0x1a", "sym.isra.0", "[unknown]", ... */
+static int perf_record(const char* sym, size_t n, const char* srcline, long long samples) {
+    g_perf_total += samples;
+
+    size_t len = 0;
+    while (len < n && sym[len] != '+' && sym[len] != '.' && sym[len] != ' ') len++;
+    if (len > 0 && sym[0] != '[' && perfmap_add(&g_perf_syms, sym, len, samples) != 0) return -1;
+
+    if (srcline) {
+        const char* base = path_basename(srcline);
+        if (perfmap_add(&g_perf_lines, base, strlen(base), samples) != 0) return -1;
+    }
+    return 0;
+}
+
+/* "<file>:<digits>" with no spaces, as printed by perf's srcline field */
+static int is_srcline(const char* s) {
+    const char* colon = strrchr(s, ':');
+    if (!colon || colon == s || !colon[1] || strchr(s, ' ')) return 0;
+    for (const char* p = colon + 1; *p; ++p) if (!isdigit((unsigned char)*p)) return 0;
+    return 1;
+}
+
+/* Symbol of a perf frame "  55d0c0 draw_table+0x2a (/usr/bin/itable)" */
+static void perf_frame_symbol(const char* s, const char** sym, size_t* n) {
+    while (isspace((unsigned char)*s)) s++;
+    while (isxdigit((unsigned char)*s)) s++;       /* address */
+    while (isspace((unsigned char)*s)) s++;
+    const char* end = s + strlen(s);
+    for (const char* p = end; p > s; --p) {       /* drop trailing " (dso)" */
+        if (p[-1] == ' ' && *p == '(') { end = p - 1; break; }
+    }
+    *sym = s;
+    *n = (size_t)(end - s);
+}
+
+static void trim_eol(char* s) {
+    size_t n = strlen(s);
+    while (n && (s[n - 1] == '\n' || s[n - 1] == '\r' || s[n - 1] == ' ')) s[--n] = '\0';
+}
+
+/* Stream a perf script / folded file into the maps. Returns 0 on success. */
+static int perf_load(const char* path) {
+    FILE* f = fopen(path, "r");
+    if (!f) { perror(path); return -1; }
+
+    char* line = NULL;
+    size_t line_cap = 0;
+    int rc = 0;
+
+    /* perf script state: awaiting the leaf frame / its optional srcline */
+    enum { PS_IDLE, PS_WANT_LEAF, PS_WANT_SRC } st = PS_IDLE;
+    char   leaf[256];
+    size_t leaf_len = 0;
+
+    while (rc == 0 && getline(&line, &line_cap, f) != -1) {
+        trim_eol(line);
+        int indented = (line[0] == ' ' || line[0] == '\t');
+
+        if (st == PS_WANT_SRC) {
+            /* the line after the leaf frame may carry its srcline */
+            char* t = line;
+            while (isspace((unsigned char)*t)) t++;
+            int src = indented && is_srcline(t);
+            rc = perf_record(leaf, leaf_len, src ? t : NULL, 1);
+            st = PS_IDLE;
+            if (src) continue;
+        }
+
+        if (line[0] == '\0') { st = PS_IDLE; continue; }
+
+        if (indented) {
+            if (st == PS_WANT_LEAF) {
+                const char* sym; size_t n;
+                perf_frame_symbol(line, &sym, &n);
+                leaf_len = (n < sizeof(leaf)) ? n : sizeof(leaf) - 1;
+                memcpy(leaf, sym, leaf_len);
+                st = PS_WANT_SRC;
+            }
+            continue;
+        }
+
+        /* Unindented: a folded stack "a;b;leaf 42" or a perf sample header */
+        char* sp = strrchr(line, ' ');
+        int folded = sp && sp[1] && !strstr(line, ": ");
+        for (char* p = sp ? sp + 1 : NULL; folded && *p; ++p) folded = isdigit((unsigned char)*p);
+        if (folded) {
+            *sp = '\0';
+            const char* leafsym = strrchr(line, ';');
+            leafsym = leafsym ? leafsym + 1 : line;
+            rc = perf_record(leafsym, strlen(leafsym), NULL, strtoll(sp + 1, NULL, 10));
+        } else if (line[strlen(line) - 1] == ')') {
+            /* sample without callchain: header ends with "addr sym+off (dso)" */
+            const char* ev = strstr(line, ": ");
+            const char* sym; size_t n;
+            ev = ev ? strstr(ev + 2, ": ") : NULL;   /* skip "time:" then "event:" */
+            perf_frame_symbol(ev ? ev + 2 : line, &sym, &n);
+            leaf_len = (n < sizeof(leaf)) ? n : sizeof(leaf) - 1;
+            memcpy(leaf, sym, leaf_len);
+            st = PS_WANT_SRC;
+        } else {
+            st = PS_WANT_LEAF;
+        }
+    }
+    if (rc == 0 && st == PS_WANT_SRC) rc = perf_record(leaf, leaf_len, NULL, 1);
+
+    if (rc != 0) fprintf(stderr, "Out of memory while reading %s\n", path);
+    free(line);
     fclose(f);
+    return rc;
+}
 
-    /* Summary calculations */
-    int loc = lineno;
-    double avg = (code_cnt > 0) ? ((double)total_score / (double)code_cnt) : 0.0;
+/* Attach sample counts to every function of one file */
+static void perf_attribute(const char* path, FileReport* fr) {
+    const char* base = path_basename(path);
+    for (size_t i = 0; i < fr->funcs_len; i++) {
+        FuncReport* fn = &fr->funcs[i];
+        long long by_line = 0;
+        if (g_perf_lines.len) {
+            char key[4200];
+            for (int ln = fn->start_line; ln <= fn->end_line; ln++) {
+                int n = snprintf(key, sizeof(key), "%s:%d", base, ln);
+                if (n > 0 && (size_t)n < sizeof(key)) by_line += perfmap_get(&g_perf_lines, key, (size_t)n);
+            }
+        }
+        fn->samples = by_line ? by_line : perfmap_get(&g_perf_syms, fn->name, strlen(fn->name));
+    }
+}
+
+static double cpu_share_pct(const FuncReport* fn) {
+    return g_perf_total ? 100.0 * (double)fn->samples / (double)g_perf_total : 0.0;
+}
 
-    /* Emit Markdown report */
-    printf("# C Complexity Report\n\n");
+/* --------------------------------------------------------------------------
+ * Markdown report
+ * -------------------------------------------------------------------------- */
+
+static void emit_markdown(const char* title, const FileReport* fr) {
+    double avg = (fr->code_cnt > 0) ? ((double)fr->total_score / (double)fr->code_cnt) : 0.0;
+
+    printf("# %s\n\n", title);
     printf("## Summary\n");
-    printf("- **Total lines**: %d\n", loc);
-    printf("- **Code lines**: %d\n", code_cnt);
-    printf("- **Comment lines**: %d\n", comment_cnt);
-    printf("- **Preprocessor lines**: %d\n", preproc_cnt);
-    printf("- **Blank lines**: %d\n", blank_cnt);
-    printf("- **Total line complexity score**: %d\n", total_score);
+    printf("- **Total lines**: %d\n", fr->total_lines);
+    printf("- **Code lines**: %d\n", fr->code_cnt);
+    printf("- **Comment lines**: %d\n", fr->comment_cnt);
+    printf("- **Preprocessor lines**: %d\n", fr->preproc_cnt);
+    printf("- **Blank lines**: %d\n", fr->blank_cnt);
+    printf("- **Total line complexity score**: %d\n", fr->total_score);
     printf("- **Average per code line**: %.2f\n", avg);
+    for (int pi = 1; pi < g_nprofiles; pi++) {
+        printf("- **Total score, profile `%s`** (vs `%s`): %d\n",
+               g_profiles[pi].name, g_profiles[0].name, fr->profile_totals[pi]);
+    }
 
-    if (funcs_len > 0) {
+    if (fr->funcs_len > 0) {
         printf("\n## Per-Function Cyclomatic Complexity (heuristic)\n");
-        printf("| Function | Start Line | End Line | Complexity |\n|---|---:|---:|---:|\n");
-        for (size_t i = 0; i < funcs_len; i++) {
-            printf("| `%s` | %d | %d | %d |\n",
-                   funcs[i].name, funcs[i].start_line, funcs[i].end_line, funcs[i].cyclomatic);
+        printf("| Function | Start Line | End Line | Complexity |%s\n|---|---:|---:|---:|%s\n",
+               g_perf_total ? " Samples | CPU % |" : "", g_perf_total ? "---:|---:|" : "");
+        for (size_t i = 0; i < fr->funcs_len; i++) {
+            const FuncReport* fn = &fr->funcs[i];
+            printf("| `%s` | %d | %d | %d |",
+                   fn->name, fn->start_line, fn->end_line, fn->cyclomatic);
+            if (g_perf_total) printf(" %lld | %.2f |", fn->samples, cpu_share_pct(fn));
+            printf("\n");
         }
     } else {
         printf("\n> No functions detected by the heuristic parser.\n");
     }
 
-    printf("\n## Per-Line Complexity (first %d lines)\n", PER_LINE_LIMIT);
+    printf("\n## Per-Line Complexity (first %d lines)\n", g_per_line_limit);
     printf("| # | Depth | Score | Flags | Code |\n|---:|---:|---:|---|---|\n");
-    for (size_t i = 0; i < lines_len && i < PER_LINE_LIMIT; i++) {
-        LineReport* lr = &lines[i];
+    for (size_t i = 0; i < fr->lines_len && i < (size_t)g_per_line_limit; i++) {
+        const LineReport* lr = &fr->lines[i];
 
         /* Escape '|' in preview for Markdown table cells */
         char esc[(PREVIEW_CHARS * 2) + 4];
@@ -567,20 +1222,499 @@ int main(int argc, char** argv) {
                lr->lineno, lr->depth, lr->score, lr->flags ? lr->flags : "", esc);
     }
 
-    if ((int)lines_len > PER_LINE_LIMIT) {
+    if (fr->lines_len > (size_t)g_per_line_limit) {
         printf("\n> Truncated to first %d lines out of %zu. "
-               "Recompile with a higher PER_LINE_LIMIT to include more.\n",
-               PER_LINE_LIMIT, lines_len);
+               "Pass a higher --per-line-limit to include more.\n",
+               g_per_line_limit, fr->lines_len);
     }
+}
+
+/* --------------------------------------------------------------------------
+ * Buffered output writer for the machine-readable formats
+ * Rows are formatted straight into a large buffer and handed to fwrite()
+ * in big chunks, instead of one printf() call per field.
+ * -------------------------------------------------------------------------- */
+
+#ifndef OUTBUF_BYTES
+#define OUTBUF_BYTES (1u << 20)
+#endif
 
-    /* Free all allocated memory */
-    for (size_t i = 0; i < lines_len; i++) {
-        free(lines[i].flags);
-        free(lines[i].text);
+typedef struct {
+    FILE*  f;
+    size_t len;
+    int    err;
+    char   buf[OUTBUF_BYTES];
+} OutBuf;
+
+static void ob_flush(OutBuf* ob) {
+    if (ob->len && fwrite(ob->buf, 1, ob->len, ob->f) != ob->len) ob->err = 1;
+    ob->len = 0;
+}
+
+static void ob_put(OutBuf* ob, const void* p, size_t n) {
+    if (n > OUTBUF_BYTES - ob->len) {
+        ob_flush(ob);
+        if (n > OUTBUF_BYTES) {
+            if (fwrite(p, 1, n, ob->f) != n) ob->err = 1;
+            return;
+        }
     }
-    free(lines);
-    free(funcs);
+    memcpy(ob->buf + ob->len, p, n);
+    ob->len += n;
+}
 
-    return 0;
+static void ob_str(OutBuf* ob, const char* s) { ob_put(ob, s, strlen(s)); }
+
+/* Little-endian whatever the host byte order */
+static void ob_u32(OutBuf* ob, uint32_t v) {
+    unsigned char b[4] = { (unsigned char)v, (unsigned char)(v >> 8),
+                           (unsigned char)(v >> 16), (unsigned char)(v >> 24) };
+    ob_put(ob, b, sizeof(b));
+}
+static void ob_i32(OutBuf* ob, int32_t v)  { ob_u32(ob, (uint32_t)v); }
+
+/* Decimal integer without going through printf */
+static void ob_int(OutBuf* ob, long long v) {
+    char tmp[24];
+    int n = 0;
+    unsigned long long u = (v < 0) ? 0ULL - (unsigned long long)v : (unsigned long long)v;
+    do { tmp[sizeof(tmp) - 1 - n++] = (char)('0' + u % 10); u /= 10; } while (u);
+    if (v < 0) tmp[sizeof(tmp) - 1 - n++] = '-';
+    ob_put(ob, tmp + sizeof(tmp) - n, (size_t)n);
+}
+
+/* JSON string literal with the mandatory escapes */
+static void ob_json_str(OutBuf* ob, const char* s) {
+    static const char hex[] = "0123456789abcdef";
+    ob_put(ob, "\"", 1);
+    const char* run = s;
+    for (; *s; ++s) {
+        unsigned char c = (unsigned char)*s;
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+        ob_put(ob, run, (size_t)(s - run));
+        run = s + 1;
+        if (c == '"')       ob_put(ob, "\\\"", 2);
+        else if (c == '\\') ob_put(ob, "\\\\", 2);
+        else if (c == '\n') ob_put(ob, "\\n", 2);
+        else if (c == '\t') ob_put(ob, "\\t", 2);
+        else if (c == '\r') ob_put(ob, "\\r", 2);
+        else {
+            char u[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 15] };
+            ob_put(ob, u, sizeof(u));
+        }
+    }
+    ob_put(ob, run, (size_t)(s - run));
+    ob_put(ob, "\"", 1);
+}
+
+static void ob_json_key_int(OutBuf* ob, const char* key, long long v) {
+    ob_put(ob, ",\"", 2); ob_str(ob, key); ob_put(ob, "\":", 2); ob_int(ob, v);
+}
+
+/* --------------------------------------------------------------------------
+ * JSON Lines report (--format jsonl)
+ * One object per line; every object carries "type" and "path":
+ *   {"type":"file","path":..,"total_lines":..,"code":..,"comment":..,
+ *    "preproc":..,"blank":..,"total_score":..
+ *    [,"profile_scores":{"<name>":..,...}]}      (only with several profiles)
+ *   {"type":"func","path":..,"name":..,"start":..,"end":..,"cyclomatic":..,"score":..}
+ *   {"type":"line","path":..,"line":..,"depth":..,"score":..,"flags":..,"text":..}
+ * Unlike the Markdown table, all lines are emitted (no PER_LINE_LIMIT).
+ * -------------------------------------------------------------------------- */
+
+static void emit_jsonl(OutBuf* ob, const char* path, const FileReport* fr) {
+    ob_str(ob, "{\"type\":\"file\",\"path\":");
+    ob_json_str(ob, path);
+    ob_json_key_int(ob, "total_lines", fr->total_lines);
+    ob_json_key_int(ob, "code", fr->code_cnt);
+    ob_json_key_int(ob, "comment", fr->comment_cnt);
+    ob_json_key_int(ob, "preproc", fr->preproc_cnt);
+    ob_json_key_int(ob, "blank", fr->blank_cnt);
+    ob_json_key_int(ob, "total_score", fr->total_score);
+    if (g_nprofiles > 1) {
+        ob_str(ob, ",\"profile_scores\":{");
+        for (int pi = 0; pi < g_nprofiles; pi++) {
+            if (pi) ob_put(ob, ",", 1);
+            ob_json_str(ob, g_profiles[pi].name);
+            ob_put(ob, ":", 1);
+            ob_int(ob, fr->profile_totals[pi]);
+        }
+        ob_put(ob, "}", 1);
+    }
+    ob_str(ob, "}\n");
+
+    for (size_t i = 0; i < fr->funcs_len; i++) {
+        const FuncReport* fn = &fr->funcs[i];
+        ob_str(ob, "{\"type\":\"func\",\"path\":");
+        ob_json_str(ob, path);
+        ob_str(ob, ",\"name\":");
+        ob_json_str(ob, fn->name);
+        ob_json_key_int(ob, "start", fn->start_line);
+        ob_json_key_int(ob, "end", fn->end_line);
+        ob_json_key_int(ob, "cyclomatic", fn->cyclomatic);
+        ob_json_key_int(ob, "score", fn->score_sum);
+        if (g_perf_total) ob_json_key_int(ob, "samples", fn->samples);
+        ob_str(ob, "}\n");
+    }
+
+    for (size_t i = 0; i < fr->lines_len; i++) {
+        const LineReport* lr = &fr->lines[i];
+        ob_str(ob, "{\"type\":\"line\",\"path\":");
+        ob_json_str(ob, path);
+        ob_json_key_int(ob, "line", lr->lineno);
+        ob_json_key_int(ob, "depth", lr->depth);
+        ob_json_key_int(ob, "score", lr->score);
+        ob_str(ob, ",\"flags\":");
+        ob_json_str(ob, lr->flags ? lr->flags : "");
+        ob_str(ob, ",\"text\":");
+        ob_json_str(ob, lr->text ? lr->text : "");
+        ob_str(ob, "}\n");
+    }
+}
+
+/* --------------------------------------------------------------------------
+ * Binary columnar report (--format bin)
+ * Little-endian; all integers are 32-bit.
+ *   stream   := "CCB1" file*
+ *   file     := u32 path_len, path bytes,
+ *               i32 total_lines code comment preproc blank total_score,
+ *               u32 nfuncs, i32 start[n], i32 end[n], i32 cyclomatic[n],
+ *                           i32 score[n], strcol name,
+ *               u32 nlines, i32 lineno[n], i32 depth[n], i32 score[n],
+ *                           strcol flags, strcol text
+ *   strcol   := u32 offset[n+1], bytes[offset[n]]   (no NUL terminators)
+ * A reader can mmap the stream and take each column as a typed array.
+ * -------------------------------------------------------------------------- */
+
+typedef const char* (*StrColGet)(const FileReport* fr, size_t i);
+
+static const char* col_func_name(const FileReport* fr, size_t i)  { return fr->funcs[i].name; }
+static const char* col_line_flags(const FileReport* fr, size_t i) { return fr->lines[i].flags ? fr->lines[i].flags : ""; }
+static const char* col_line_text(const FileReport* fr, size_t i)  { return fr->lines[i].text ? fr->lines[i].text : ""; }
+
+/* strcol: n+1 running offsets, then the concatenated bytes */
+static void ob_strcol(OutBuf* ob, const FileReport* fr, size_t n, StrColGet get) {
+    uint32_t off = 0;
+    ob_u32(ob, 0);
+    for (size_t i = 0; i < n; i++) {
+        off += (uint32_t)strlen(get(fr, i));
+        ob_u32(ob, off);
+    }
+    for (size_t i = 0; i < n; i++) ob_str(ob, get(fr, i));
+}
+
+static void emit_binary(OutBuf* ob, const char* path, const FileReport* fr) {
+    ob_u32(ob, (uint32_t)strlen(path));
+    ob_str(ob, path);
+    ob_i32(ob, fr->total_lines);
+    ob_i32(ob, fr->code_cnt);
+    ob_i32(ob, fr->comment_cnt);
+    ob_i32(ob, fr->preproc_cnt);
+    ob_i32(ob, fr->blank_cnt);
+    ob_i32(ob, fr->total_score);
+
+    size_t nf = fr->funcs_len;
+    ob_u32(ob, (uint32_t)nf);
+    for (size_t i = 0; i < nf; i++) ob_i32(ob, fr->funcs[i].start_line);
+    for (size_t i = 0; i < nf; i++) ob_i32(ob, fr->funcs[i].end_line);
+    for (size_t i = 0; i < nf; i++) ob_i32(ob, fr->funcs[i].cyclomatic);
+    for (size_t i = 0; i < nf; i++) ob_i32(ob, fr->funcs[i].score_sum);
+    ob_strcol(ob, fr, nf, col_func_name);
+
+    size_t nl = fr->lines_len;
+    ob_u32(ob, (uint32_t)nl);
+    for (size_t i = 0; i < nl; i++) ob_i32(ob, fr->lines[i].lineno);
+    for (size_t i = 0; i < nl; i++) ob_i32(ob, fr->lines[i].depth);
+    for (size_t i = 0; i < nl; i++) ob_i32(ob, fr->lines[i].score);
+    ob_strcol(ob, fr, nl, col_line_flags);
+    ob_strcol(ob, fr, nl, col_line_text);
+}
+
+/* --------------------------------------------------------------------------
+ * Hotspot ranking (--top K)
+ * A bounded min-heap of the K worst functions seen so far across all files.
+ * Each file's FuncReports are offered to the heap and then freed with the
+ * file, so memory stays O(K) no matter how many functions are scanned.
+ * -------------------------------------------------------------------------- */
+
+typedef enum { RANK_CYCLOMATIC = 0, RANK_SCORE, RANK_LENGTH, RANK_HOT } RankBy;
+
+/* "hot" = cyclomatic x CPU share; needs --perf */
+static const char* const RANK_NAMES[] = { "cyclomatic", "score", "length", "hot" };
+
+typedef struct {
+    long long   key;    /* ranking key; larger is worse */
+    const char* path;   /* points into argv, lives for the whole run */
+    FuncReport  fn;
+} RankEntry;
+
+typedef struct {
+    RankEntry* v;
+    size_t     len, cap;
+} TopK;
+
+static long long rank_key(const FuncReport* fn, RankBy by) {
+    switch (by) {
+        case RANK_SCORE:  return fn->score_sum;
+        case RANK_LENGTH: return (long long)fn->end_line - fn->start_line + 1;
+        case RANK_HOT:    return (long long)fn->cyclomatic * fn->samples; /* x 1/total is constant */
+        default:          return fn->cyclomatic;
+    }
+}
+
+static void topk_swap(RankEntry* a, RankEntry* b) { RankEntry t = *a; *a = *b; *b = t; }
+
+static void topk_sift_down(RankEntry* v, size_t len, size_t i) {
+    for (;;) {
+        size_t l = 2 * i + 1, r = l + 1, m = i;
+        if (l < len && v[l].key < v[m].key) m = l;
+        if (r < len && v[r].key < v[m].key) m = r;
+        if (m == i) return;
+        topk_swap(&v[i], &v[m]);
+        i = m;
+    }
 }
 
+/* Offer one function; keeps it only if it beats the current K-th worst */
+static void topk_offer(TopK* t, long long key, const char* path, const FuncReport* fn) {
+    if (t->cap == 0) return;
+    if (t->len < t->cap) {
+        size_t i = t->len++;
+        t->v[i].key = key; t->v[i].path = path; t->v[i].fn = *fn;
+        while (i > 0 && t->v[(i - 1) / 2].key > t->v[i].key) {
+            topk_swap(&t->v[(i - 1) / 2], &t->v[i]);
+            i = (i - 1) / 2;
+        }
+    } else if (key > t->v[0].key) {
+        t->v[0].key = key; t->v[0].path = path; t->v[0].fn = *fn;
+        topk_sift_down(t->v, t->len, 0);
+    }
+}
+
+/* Heap-sort in place so v[0] is the worst; the heap is unusable afterwards */
+static void topk_finish(TopK* t) {
+    for (size_t n = t->len; n > 1; n--) {
+        topk_swap(&t->v[0], &t->v[n - 1]);
+        topk_sift_down(t->v, n - 1, 0);
+    }
+}
+
+static void emit_topk_markdown(const TopK* t, RankBy by) {
+    printf("# C Complexity Hotspots (top %zu by %s)\n\n", t->cap, RANK_NAMES[by]);
+    if (t->len == 0) {
+        printf("> No functions detected by the heuristic parser.\n");
+        return;
+    }
+    printf("| Rank | Function | File | Start Line | End Line | Length | Complexity | Score |%s\n"
+           "|---:|---|---|---:|---:|---:|---:|---:|%s\n",
+           g_perf_total ? " Samples | CPU % | Complexity x CPU % |" : "",
+           g_perf_total ? "---:|---:|---:|" : "");
+    for (size_t i = 0; i < t->len; i++) {
+        const FuncReport* fn = &t->v[i].fn;
+        printf("| %zu | `%s` | `%s` | %d | %d | %d | %d | %d |",
+               i + 1, fn->name, t->v[i].path, fn->start_line, fn->end_line,
+               fn->end_line - fn->start_line + 1, fn->cyclomatic, fn->score_sum);
+        if (g_perf_total) {
+            printf(" %lld | %.2f | %.2f |", fn->samples, cpu_share_pct(fn),
+                   fn->cyclomatic * cpu_share_pct(fn));
+        }
+        printf("\n");
+    }
+}
+
+/* {"type":"rank","rank":..,"by":..,"key":..} followed by the func fields */
+static void emit_topk_jsonl(OutBuf* ob, const TopK* t, RankBy by) {
+    for (size_t i = 0; i < t->len; i++) {
+        const FuncReport* fn = &t->v[i].fn;
+        ob_str(ob, "{\"type\":\"rank\"");
+        ob_json_key_int(ob, "rank", (long long)i + 1);
+        ob_str(ob, ",\"by\":");
+        ob_json_str(ob, RANK_NAMES[by]);
+        ob_json_key_int(ob, "key", t->v[i].key);
+        ob_str(ob, ",\"path\":");
+        ob_json_str(ob, t->v[i].path);
+        ob_str(ob, ",\"name\":");
+        ob_json_str(ob, fn->name);
+        ob_json_key_int(ob, "start", fn->start_line);
+        ob_json_key_int(ob, "end", fn->end_line);
+        ob_json_key_int(ob, "cyclomatic", fn->cyclomatic);
+        ob_json_key_int(ob, "score", fn->score_sum);
+        if (g_perf_total) ob_json_key_int(ob, "samples", fn->samples);
+        ob_str(ob, "}\n");
+    }
+}
+
+/* --------------------------------------------------------------------------
+ * Entry point
+ * -------------------------------------------------------------------------- */
+
+static void usage(const char* argv0) {
+    fprintf(stderr,
+            "Usage: %s [options] <file.c> [file.c ...] > report\n"
+            "  --cache DIR          reuse results for unchanged files\n"
+            "  --format md|jsonl|bin\n"
+            "  --profile FILE       add a scoring profile (\"default\" = built-in weights);\n"
+            "                       repeat for A/B totals, the first one drives line scores\n"
+            "  --weight KEY=VALUE   override a knob of the last profile\n"
+            "  --per-line-limit N   rows in the Markdown per-line table\n"
+            "  --top K              only report the K worst functions across all files\n"
+            "  --rank cyclomatic|score|length|hot   ranking key for --top (default cyclomatic)\n"
+            "  --perf FILE          join self samples from `perf script` or folded stacks;\n"
+            "                       --rank hot orders by complexity x CPU share\n",
+            argv0);
+}
+
+typedef enum { FMT_MARKDOWN = 0, FMT_JSONL, FMT_BINARY } OutFormat;
+
+int main(int argc, char** argv) {
+    const char* cache_dir = NULL;
+    OutFormat fmt = FMT_MARKDOWN;
+    size_t top_k = 0;
+    RankBy rank_by = RANK_CYCLOMATIC;
+    const char* perf_path = NULL;
+    int argi = 1;
+    for (; argi < argc && argv[argi][0] == '-' && argv[argi][1] == '-'; argi++) {
+        if (!strcmp(argv[argi], "--cache") && argi + 1 < argc) {
+            cache_dir = argv[++argi];
+        } else if (!strcmp(argv[argi], "--format") && argi + 1 < argc) {
+            const char* f = argv[++argi];
+            if (!strcmp(f, "md"))         fmt = FMT_MARKDOWN;
+            else if (!strcmp(f, "jsonl")) fmt = FMT_JSONL;
+            else if (!strcmp(f, "bin"))   fmt = FMT_BINARY;
+            else { usage(argv[0]); return 1; }
+        } else if (!strcmp(argv[argi], "--profile") && argi + 1 < argc) {
+            const char* file = argv[++argi];
+            if (g_nprofiles == MAX_PROFILES) {
+                fprintf(stderr, "At most %d profiles\n", MAX_PROFILES);
+                return 1;
+            }
+            Profile* pr = &g_profiles[g_nprofiles++];
+            if (!strcmp(file, "default")) profile_defaults(pr, "default");
+            else if (profile_load(pr, file) != 0) return 1;
+        } else if (!strcmp(argv[argi], "--weight") && argi + 1 < argc) {
+            char kv[128], *key, *val;
+            snprintf(kv, sizeof(kv), "%s", argv[++argi]);
+            if (g_nprofiles == 0) profile_defaults(&g_profiles[g_nprofiles++], "default");
+            if (split_assignment(kv, &key, &val) != 0 ||
+                profile_set(&g_profiles[g_nprofiles - 1], key, val) != 0) {
+                fprintf(stderr, "Bad --weight '%s'\n", argv[argi]);
+                return 1;
+            }
+        } else if (!strcmp(argv[argi], "--per-line-limit") && argi + 1 < argc) {
+            g_per_line_limit = atoi(argv[++argi]);
+            if (g_per_line_limit < 0) g_per_line_limit = 0;
+        } else if (!strcmp(argv[argi], "--top") && argi + 1 < argc) {
+            long k = strtol(argv[++argi], NULL, 10);
+            top_k = (k > 0) ? (size_t)k : 0;
+        } else if (!strcmp(argv[argi], "--rank") && argi + 1 < argc) {
+            const char* r = argv[++argi];
+            size_t i = 0;
+            while (i < sizeof(RANK_NAMES)/sizeof(RANK_NAMES[0]) && strcmp(r, RANK_NAMES[i])) i++;
+            if (i == sizeof(RANK_NAMES)/sizeof(RANK_NAMES[0])) { usage(argv[0]); return 1; }
+            rank_by = (RankBy)i;
+        } else if (!strcmp(argv[argi], "--perf") && argi + 1 < argc) {
+            perf_path = argv[++argi];
+        } else if (!strcmp(argv[argi], "--")) {
+            argi++;
+            break;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (argi >= argc) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (top_k && fmt == FMT_BINARY) {
+        fprintf(stderr, "--top supports the md and jsonl formats\n");
+        return 1;
+    }
+    if (rank_by == RANK_HOT && !perf_path) {
+        fprintf(stderr, "--rank hot needs --perf FILE\n");
+        return 1;
+    }
+    if (perf_path && perf_load(perf_path) != 0) return 1;
+    if (g_nprofiles == 0) profile_defaults(&g_profiles[g_nprofiles++], "default");
+    for (int pi = 0; pi < g_nprofiles; pi++) profile_compile(&g_profiles[pi]);
+
+    int nfiles = argc - argi;
+    uint64_t cfg = config_hash();
+    int status = 0;
+
+    OutBuf* ob = NULL;
+    if (fmt != FMT_MARKDOWN) {
+        ob = (OutBuf*)malloc(sizeof(OutBuf));
+        if (!ob) { fprintf(stderr, "Out of memory\n"); return 2; }
+        ob->f = stdout; ob->len = 0; ob->err = 0;
+        if (fmt == FMT_BINARY) ob_put(ob, "CCB1", 4);
+    }
+
+    TopK top = { NULL, 0, top_k };
+    if (top_k) {
+        top.v = (RankEntry*)malloc(top_k * sizeof(RankEntry));
+        if (!top.v) { fprintf(stderr, "Out of memory\n"); free(ob); return 2; }
+    }
+
+    for (; argi < argc; argi++) {
+        const char* path = argv[argi];
+        char* buf = NULL;
+        size_t buf_len = 0;
+        if (read_file(path, &buf, &buf_len) != 0) {
+            perror(path);
+            status = 1;
+            continue;
+        }
+
+        FileReport fr;
+        char entry[4096];
+        uint64_t chash = 0;
+        int hit = 0;
+        if (cache_dir) {
+            chash = xxh64(buf, buf_len, 0);
+            cache_entry_path(cache_dir, chash, cfg, entry, sizeof(entry));
+            hit = (cache_load(entry, chash, cfg, &fr) == 0);
+        }
+        if (!hit) {
+            int rc = analyze_buffer(buf, buf_len, &fr);
+            if (rc != 0) { free(buf); free(ob); free(top.v); return rc; }
+            if (cache_dir) cache_store(entry, chash, cfg, &fr);
+        }
+        free(buf);
+        if (perf_path) perf_attribute(path, &fr);
+
+        if (top_k) {
+            for (size_t i = 0; i < fr.funcs_len; i++)
+                topk_offer(&top, rank_key(&fr.funcs[i], rank_by), path, &fr.funcs[i]);
+        } else if (fmt == FMT_JSONL) {
+            emit_jsonl(ob, path, &fr);
+        } else if (fmt == FMT_BINARY) {
+            emit_binary(ob, path, &fr);
+        } else {
+            char title[4200];
+            if (nfiles == 1) snprintf(title, sizeof(title), "C Complexity Report");
+            else             snprintf(title, sizeof(title), "C Complexity Report: `%s`", path);
+            if (argi > argc - nfiles) printf("\n");
+            emit_markdown(title, &fr);
+        }
+        free_file_report(&fr);
+    }
+
+    if (top_k) {
+        topk_finish(&top);
+        if (fmt == FMT_JSONL) emit_topk_jsonl(ob, &top, rank_by);
+        else                  emit_topk_markdown(&top, rank_by);
+        free(top.v);
+    }
+
+    perfmap_free(&g_perf_syms);
+    perfmap_free(&g_perf_lines);
+
+    if (ob) {
+        ob_flush(ob);
+        if (ob->err || fflush(stdout) != 0) { perror("write"); status = 1; }
+        free(ob);
+    }
+    return status;
+}
@@ -1,139 +1,4939 @@
 // itable.c
 // Interactive terminal table with per-row actions using ncurses.
 // Keys: ↑/↓/k/j to move, ←/→/h/l to change column, Enter/Space to view,
-//       e to edit cell, a to add row, d to delete row, q to quit.
+//       PgUp/PgDn/Home/End to page, e to edit cell, a to add row,
+//       d to delete row (or marked rows), m/J/K to mark, f to mark by
+//       filter, s/c to set/cycle status, n to toggle name order,
+//       / to jump to a name prefix, x to export CSV, w to save as
+//       .itb/.itz, i to remove duplicate IDs, o to toggle ID order,
+//       t to show timings, u to dump timings, p to pause follow mode,
+//       q to quit.
+// Usage: itable                 built-in sample rows (in memory)
+//        itable table.csv       load a CSV (ID,Name,Status) into memory
+//        itable table.itb       page a fixed-record file of any size
+//        itable gen:N           browse N generated rows without storing them
+//        itable table.itz       page a compressed table, decoding only
+//                               the blocks around the viewport
+//        itable --mem table.itz decompress all blocks in parallel into memory
+//        itable --timings ...   start with latency timings recording
+//        itable --follow [file.csv]
+//                               keep appending rows written to the file
+//                               (or to stdin), like tail -f; p pauses
+//        itable --serve PATH ...
+//                               answer LEN/GET/SCAN/COUNT/SET requests on a
+//                               Unix socket while the table is open
+//        itable --client PATH [--bench N]
+//                               send stdin to a server and print replies
+//        itable --shm NAME ...  mirror the table into POSIX shared memory
+//                               (layout and reader: itable_shm.h)
+//        itable --shm-read NAME [--bench N]
+//                               count rows by status from the segment
+//        itable --ncurses ...   draw with ncurses instead of the diffing
+//                               cell buffer (one write() per frame)
+//        itable --sort id [--bench N] ...
+//                               open in ID order (radix sort); --bench
+//                               times it against qsort and exits
+//        itable --dedup first|last|merge|check ...
+//                               remove rows that repeat an ID (check only
+//                               counts them); without it, a load-time check
+//                               flags duplicates in the header
+//        itable --filter EXPR [--bench N] [--out FILE] ...
+//                               count rows matching a filter expression;
+//                               --bench times interpreted vs specialized,
+//                               --out saves the matching rows as CSV
+//        itable --gen N [--name-len MIN:MAX] [--status-mix A:P:X]
+//                       [--ids dense|sparse|dup] [--seed S]
+//                               generate N rows in memory, in parallel
+//        itable --schema "qty:int64,price:double:10,region:dict,notes:str:24" ...
+//                               add typed columns after ID/Name/Status
+//        itable --freeze N ...  keep the first N columns on screen (default 1)
 
 #define _XOPEN_SOURCE 700
+#define _DEFAULT_SOURCE          // syscall() for io_uring on glibc
 #include <ncurses.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <time.h>
 #include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/time.h>
+#include <sys/un.h>
 #include <unistd.h>
+#include "itable_shm.h"
 #ifdef __APPLE__
 #include <mach/mach.h>
 #endif
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define ITABLE_HAVE_URING 1
+#endif
+#endif
+#endif
+
+
+#define MAX_COLS 64
+#define BUILTIN_COLS 3          // ID, Name, Status live in Row
+#define COL0_W 6
+#define COL1_W 18
+#define COL2_W 12
+
+typedef struct {
+    int id;
+    char name[64];
+    char status[32];
+} Row;
+
+/* ---------------------------------------------------------------------------
+ * Schema: the columns the UI shows. The first BUILTIN_COLS map to Row
+ * fields; extra columns (--schema, or CSV headers with more fields) are
+ * typed and stored column-wise next to the rows of an in-memory RowVec.
+ * --------------------------------------------------------------------------- */
+typedef enum { CT_INT64, CT_DOUBLE, CT_DICT, CT_STR } ColType;
+enum { FIELD_ID, FIELD_NAME, FIELD_STATUS, FIELD_EXTRA };
+
+#define WSTAT_MAX 40           /* auto width cap; longer cells share the last bucket */
+
+typedef struct {
+    uint64_t hist[WSTAT_MAX + 1];   /* estimated cells per display length */
+    uint64_t total;
+} WidthStats;
+
+typedef struct {
+    char    name[32];
+    ColType type;
+    int     width;             /* display width in cells */
+    int     field;             /* FIELD_*; extras are RowVec.extra[col - BUILTIN_COLS] */
+    int     fixed;             /* width given by the user, not auto-sized */
+    WidthStats ws;             /* see schema_autosize() */
+} ColumnDef;
+
+typedef struct {
+    int       ncols;
+    ColumnDef col[MAX_COLS];
+    int       frozen;              /* leading key columns that never scroll away */
+    int       col_x[MAX_COLS + 1]; /* x offset of each column in a full line; see schema_layout() */
+} Schema;
+
+static Schema g_schema = { BUILTIN_COLS, {
+    { "ID",     CT_INT64, COL0_W, FIELD_ID,     0, { { 0 }, 0 } },
+    { "Name",   CT_STR,   COL1_W, FIELD_NAME,   0, { { 0 }, 0 } },
+    { "Status", CT_STR,   COL2_W, FIELD_STATUS, 0, { { 0 }, 0 } },
+}, 1, { 0 } };
+
+/* Recompute column offsets; every cell is " text " (width + 2) */
+static void schema_layout(void) {
+    g_schema.col_x[0] = 0;
+    for (int c = 0; c < g_schema.ncols; ++c) g_schema.col_x[c+1] = g_schema.col_x[c] + g_schema.col[c].width + 2;
+    if (g_schema.frozen > g_schema.ncols) g_schema.frozen = g_schema.ncols;
+}
+
+static const char* const col_type_names[] = { "int64", "double", "dict", "str" };
+
+/* Dictionary-encoded strings: each distinct value is stored once and rows
+   hold a 32-bit code. Code 0 is always "". */
+typedef struct {
+    char**    str;             /* code -> string */
+    uint32_t  n, cap;
+    uint32_t* slot;            /* open addressing, code + 1 (0 = empty) */
+    uint32_t  nslot;           /* power of two */
+} Dict;
+
+/* Variable-length strings: NUL-terminated, back to back; rows hold an
+   offset. Offset 0 is always "". Edits append, old bytes are not reused. */
+typedef struct {
+    char*  buf;
+    size_t len, cap;
+} StrHeap;
+
+typedef struct {
+    ColType type;
+    void*   data;              /* per row: int64_t, double, uint32_t code or uint64_t offset */
+    Dict    dict;
+    StrHeap heap;
+} ColStore;
+
+typedef struct {
+    Row* data;
+    size_t len;
+    size_t cap;
+    int       nextra;          /* == g_schema.ncols - BUILTIN_COLS for in-memory tables */
+    ColStore* extra;
+} RowVec;
+
+static void die_cleanup(const char* msg) {
+    endwin();
+    fprintf(stderr, "%s\n", msg);
+    exit(EXIT_FAILURE);
+}
+
+static size_t col_elem_size(ColType t) { return t == CT_DICT ? sizeof(uint32_t) : 8; }
+
+static uint64_t str_hash(const char* s) {
+    uint64_t h = 1469598103934665603ull;                 /* FNV-1a */
+    while (*s) h = (h ^ (unsigned char)*s++) * 1099511628211ull;
+    return h;
+}
+
+static uint32_t dict_intern(Dict* d, const char* s) {
+    if (d->n * 2 >= d->nslot) {                           /* keep load <= 1/2 */
+        uint32_t nslot = d->nslot ? d->nslot * 2 : 64;
+        uint32_t* ns = (uint32_t*)calloc(nslot, sizeof(uint32_t));
+        if (!ns) die_cleanup("Out of memory");
+        for (uint32_t c = 0; c < d->n; ++c) {
+            uint32_t i = (uint32_t)str_hash(d->str[c]) & (nslot - 1);
+            while (ns[i]) i = (i + 1) & (nslot - 1);
+            ns[i] = c + 1;
+        }
+        free(d->slot);
+        d->slot = ns; d->nslot = nslot;
+    }
+    uint32_t i = (uint32_t)str_hash(s) & (d->nslot - 1);
+    for (; d->slot[i]; i = (i + 1) & (d->nslot - 1))
+        if (strcmp(d->str[d->slot[i] - 1], s) == 0) return d->slot[i] - 1;
+    if (d->n == d->cap) {
+        uint32_t ncap = d->cap ? d->cap * 2 : 16;
+        char** nd = (char**)realloc(d->str, ncap * sizeof(char*));
+        if (!nd) die_cleanup("Out of memory");
+        d->str = nd; d->cap = ncap;
+    }
+    d->str[d->n] = strdup(s);
+    if (!d->str[d->n]) die_cleanup("Out of memory");
+    d->slot[i] = d->n + 1;
+    return d->n++;
+}
+
+static void heap_reserve(StrHeap* h, size_t need) {
+    if (need <= h->cap) return;
+    size_t ncap = h->cap ? h->cap * 2 : 4096;
+    if (ncap < need) ncap = need;
+    char* nb = (char*)realloc(h->buf, ncap);
+    if (!nb) die_cleanup("Out of memory");
+    h->buf = nb; h->cap = ncap;
+}
+
+static uint64_t heap_add(StrHeap* h, const char* s) {
+    if (!*s) return 0;
+    size_t n = strlen(s) + 1;
+    heap_reserve(h, h->len + n);
+    memcpy(h->buf + h->len, s, n);
+    h->len += n;
+    return h->len - n;
+}
+
+static void col_store_init(ColStore* c, ColType t, size_t cap) {
+    memset(c, 0, sizeof(*c));
+    c->type = t;
+    c->data = calloc(cap ? cap : 1, col_elem_size(t));
+    if (!c->data) die_cleanup("Out of memory");
+    if (t == CT_DICT) dict_intern(&c->dict, "");
+    if (t == CT_STR) { heap_reserve(&c->heap, 1); c->heap.buf[0] = '\0'; c->heap.len = 1; }
+}
+
+static void col_store_free(ColStore* c) {
+    for (uint32_t i = 0; i < c->dict.n; ++i) free(c->dict.str[i]);
+    free(c->dict.str);
+    free(c->dict.slot);
+    free(c->heap.buf);
+    free(c->data);
+}
+
+static int64_t*  col_i64(const ColStore* c)  { return (int64_t*)c->data; }
+static double*   col_f64(const ColStore* c)  { return (double*)c->data; }
+static uint32_t* col_code(const ColStore* c) { return (uint32_t*)c->data; }
+static uint64_t* col_off(const ColStore* c)  { return (uint64_t*)c->data; }
+
+/* String value of a dict or str cell */
+static const char* col_str(const ColStore* c, size_t row) {
+    return c->type == CT_DICT ? c->dict.str[col_code(c)[row]] : c->heap.buf + col_off(c)[row];
+}
+
+/* Parse text into a cell. Returns 0, or -1 if it is not a valid number
+   (the cell is then left unchanged). */
+static int col_set_text(ColStore* c, size_t row, const char* s) {
+    char* end = NULL;
+    switch (c->type) {
+        case CT_INT64: {
+            long long v = strtoll(s, &end, 10);
+            if (end == s || *end) return -1;
+            col_i64(c)[row] = v;
+        } break;
+        case CT_DOUBLE: {
+            double v = strtod(s, &end);
+            if (end == s || *end) return -1;
+            col_f64(c)[row] = v;
+        } break;
+        case CT_DICT: col_code(c)[row] = dict_intern(&c->dict, s); break;
+        case CT_STR:  col_off(c)[row] = heap_add(&c->heap, s); break;
+    }
+    return 0;
+}
+
+static void vec_init(RowVec* v) {
+    v->data = NULL; v->len = 0; v->cap = 0;
+    v->nextra = 0; v->extra = NULL;
+}
+/* New capacity is zeroed in the extra columns (0, 0.0, "" and "") so rows
+   added by setting len directly start out empty. */
+static void vec_reserve(RowVec* v, size_t need) {
+    if (need <= v->cap) return;
+    size_t ncap = v->cap ? v->cap*2 : 8;
+    if (ncap < need) ncap = need;
+    Row* nd = (Row*)realloc(v->data, ncap * sizeof(Row));
+    if (!nd) die_cleanup("Out of memory");
+    for (int c = 0; c < v->nextra; ++c) {
+        size_t es = col_elem_size(v->extra[c].type);
+        char* cd = (char*)realloc(v->extra[c].data, ncap * es);
+        if (!cd) die_cleanup("Out of memory");
+        memset(cd + v->cap * es, 0, (ncap - v->cap) * es);
+        v->extra[c].data = cd;
+    }
+    v->data = nd; v->cap = ncap;
+}
+static void vec_push(RowVec* v, Row r) {
+    vec_reserve(v, v->len+1);
+    v->data[v->len++] = r;
+}
+static void vec_erase(RowVec* v, size_t idx) {
+    if (idx >= v->len) return;
+    for (size_t i = idx+1; i < v->len; ++i) v->data[i-1] = v->data[i];
+    for (int c = 0; c < v->nextra; ++c) {
+        size_t es = col_elem_size(v->extra[c].type);
+        char* cd = (char*)v->extra[c].data;
+        memmove(cd + idx * es, cd + (idx + 1) * es, (v->len - idx - 1) * es);
+        memset(cd + (v->len - 1) * es, 0, es);            /* keep the tail zeroed */
+    }
+    v->len--;
+}
+static void vec_free(RowVec* v) {
+    for (int c = 0; c < v->nextra; ++c) col_store_free(&v->extra[c]);
+    free(v->extra);
+    free(v->data); v->data=NULL; v->len=v->cap=0;
+    v->extra = NULL; v->nextra = 0;
+}
+
+/* Append a column to the schema and, for in-memory tables, its storage.
+   Returns 0, or -1 when the schema is full. */
+static int schema_add_column(RowVec* v, const char* name, ColType type, int width) {
+    if (g_schema.ncols >= MAX_COLS) return -1;
+    ColumnDef* cd = &g_schema.col[g_schema.ncols++];
+    snprintf(cd->name, sizeof(cd->name), "%s", name);
+    cd->type = type;
+    cd->width = width > 0 ? width : (int)strlen(cd->name) < 8 ? 8 : (int)strlen(cd->name);
+    if (cd->width > 64) cd->width = 64;
+    cd->field = FIELD_EXTRA;
+    cd->fixed = width > 0;
+    memset(&cd->ws, 0, sizeof(cd->ws));
+    schema_layout();
+    ColStore* ne = (ColStore*)realloc(v->extra, (size_t)(v->nextra + 1) * sizeof(ColStore));
+    if (!ne) die_cleanup("Out of memory");
+    v->extra = ne;
+    col_store_init(&v->extra[v->nextra++], type, v->cap);
+    return 0;
+}
+
+/* --schema "name:type[:width],...", type one of int64|double|dict|str.
+   Returns 0 or -1 on a malformed spec. */
+static int schema_parse(RowVec* v, const char* spec) {
+    char buf[1024];
+    snprintf(buf, sizeof(buf), "%s", spec);
+    for (char* save = NULL, *tok = strtok_r(buf, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        char* type = strchr(tok, ':');
+        if (!type) return -1;
+        *type++ = '\0';
+        char* width = strchr(type, ':');
+        if (width) *width++ = '\0';
+        int t = -1;
+        for (int k = 0; k < 4; ++k) if (strcmp(type, col_type_names[k]) == 0) t = k;
+        if (t < 0 || !*tok || schema_add_column(v, tok, (ColType)t, width ? atoi(width) : 0) != 0) return -1;
+    }
+    return 0;
+}
+
+/* Fast cell formatters: write into out, return the length. */
+static int fmt_i64(int64_t v, char* out) {
+    char tmp[24];
+    int n = 0, len = 0;
+    uint64_t u = v < 0 ? 0 - (uint64_t)v : (uint64_t)v;
+    do { tmp[n++] = (char)('0' + u % 10); u /= 10; } while (u);
+    if (v < 0) out[len++] = '-';
+    while (n) out[len++] = tmp[--n];
+    return len;
+}
+
+/* Two decimals; huge values, NaN and inf fall back to %g */
+static int fmt_f64(double d, char* out) {
+    if (!(d > -9e15 && d < 9e15)) return snprintf(out, 32, "%g", d);
+    int neg = d < 0;
+    uint64_t cents = (uint64_t)((neg ? -d : d) * 100.0 + 0.5);
+    int len = 0;
+    if (neg && cents) out[len++] = '-';
+    len += fmt_i64((int64_t)(cents / 100), out + len);
+    out[len++] = '.';
+    out[len++] = (char)('0' + cents / 10 % 10);
+    out[len++] = (char)('0' + cents % 10);
+    return len;
+}
+
+/* Text of cell (row r / storage index idx, column col). Strings are
+   returned in place; numbers are formatted into tmp (>= 32 bytes). */
+static const char* cell_text(const Row* r, const RowVec* v, size_t idx, int col, char* tmp, int* len) {
+    const ColumnDef* cd = &g_schema.col[col];
+    const char* s;
+    switch (cd->field) {
+        case FIELD_ID:     *len = fmt_i64(r->id, tmp); return tmp;
+        case FIELD_NAME:   s = r->name; break;
+        case FIELD_STATUS: s = r->status; break;
+        default: {
+            if (!v || col - BUILTIN_COLS >= v->nextra) { *len = 0; return ""; }
+            const ColStore* c = &v->extra[col - BUILTIN_COLS];
+            if (c->type == CT_INT64)  { *len = fmt_i64(col_i64(c)[idx], tmp); return tmp; }
+            if (c->type == CT_DOUBLE) { *len = fmt_f64(col_f64(c)[idx], tmp); return tmp; }
+            s = col_str(c, idx);
+        } break;
+    }
+    *len = (int)strlen(s);
+    return s;
+}
+
+static void seed_data(RowVec* v) {
+    for (int i=1;i<=25;i++){
+        Row r;
+        r.id = i;
+        snprintf(r.name, sizeof(r.name), "Item %02d", i);
+        snprintf(r.status, sizeof(r.status), (i%3==0)?"Pending":(i%3==1)?"Active":"Paused");
+        vec_push(v, r);
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * Parallel helpers: par_for() runs fn(ctx, i) for i in [0,n) on all cores,
+ * handing out indices dynamically so uneven items still balance.
+ * --------------------------------------------------------------------------- */
+#define PAR_MAX_THREADS 64
+
+typedef void (*ParFn)(void* ctx, size_t i);
+
+typedef struct {
+    ParFn  fn;
+    void*  ctx;
+    size_t n;
+    size_t next;    /* next unclaimed index (atomic) */
+} ParJob;
+
+static int par_threads(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n < 1) n = 1;
+    if (n > PAR_MAX_THREADS) n = PAR_MAX_THREADS;
+    return (int)n;
+}
+
+static void* par_worker(void* arg) {
+    ParJob* j = (ParJob*)arg;
+    size_t i;
+    while ((i = __atomic_fetch_add(&j->next, 1, __ATOMIC_RELAXED)) < j->n) j->fn(j->ctx, i);
+    return NULL;
+}
+
+static void par_for(size_t n, ParFn fn, void* ctx) {
+    ParJob j = { fn, ctx, n, 0 };
+    pthread_t th[PAR_MAX_THREADS];
+    int nt = par_threads(), started = 0;
+    if ((size_t)nt > n) nt = (int)n;
+    for (int t = 1; t < nt; ++t) {
+        if (pthread_create(&th[started], NULL, par_worker, &j) == 0) started++;
+    }
+    par_worker(&j);          /* the caller works too */
+    for (int t = 0; t < started; ++t) pthread_join(th[t], NULL);
+}
+
+/* ---------------------------------------------------------------------------
+ * Snapshots: lock-free reads of an in-memory table for background tasks.
+ * The UI thread is the only writer. On demand it publishes an immutable
+ * version of the rows, cut into chunks of SNAP_CHUNK rows; chunks that
+ * were not written since the previous version are shared with it, so a
+ * publish copies only the dirty chunks. A reader enters the current epoch,
+ * loads the published version and may use it for as long as it likes; it
+ * never takes a lock and the writer never waits for it. A replaced version
+ * is freed by the writer once every reader that could still hold it has
+ * left (epoch-based reclamation). Extra schema columns are not included.
+ * --------------------------------------------------------------------------- */
+#define SNAP_CHUNK    4096      /* rows per chunk */
+#define SNAP_READERS  16        /* concurrent readers */
+
+typedef struct {
+    int      refs;              /* versions sharing the chunk (writer only) */
+    uint64_t gen;               /* version that created it */
+    size_t   n;
+    Row    row[];
+} SnapChunk;
+
+typedef struct Snapshot {
+    uint64_t         version;   /* 1, 2, ... in publish order */
+    size_t           len, nchunks;
+    SnapChunk**      chunk;
+    uint64_t         retired;   /* epoch in which it was replaced */
+    struct Snapshot* next;      /* retired list */
+} Snapshot;
+
+typedef struct {
+    Snapshot* cur;                    /* published version */
+    uint64_t  epoch;
+    uint64_t  reader[SNAP_READERS];   /* epoch each reader entered in, 0 = free */
+    Snapshot* retired;                /* writer only from here on */
+    uint64_t  published;              /* versions published so far */
+    uint8_t*  dirty;                  /* per chunk */
+    size_t    dirty_cap;
+    size_t    dirty_from;             /* every chunk from here on is dirty */
+} SnapStore;
+
+static void snap_init(SnapStore* st) {
+    memset(st, 0, sizeof(*st));
+    st->epoch = 1;
+    st->dirty_from = (size_t)-1;
+}
+
+static const Row* snap_row(const Snapshot* s, size_t i) {
+    return &s->chunk[i / SNAP_CHUNK]->row[i % SNAP_CHUNK];
+}
+
+/* Rows [a, b) were written; b = (size_t)-1 when every row from a on moved */
+static void snap_touch(SnapStore* st, size_t a, size_t b) {
+    if (!st->cur) return;                      /* the first publish copies everything */
+    if (b == (size_t)-1) {
+        if (a / SNAP_CHUNK < st->dirty_from) st->dirty_from = a / SNAP_CHUNK;
+        return;
+    }
+    if (b <= a) return;
+    size_t last = (b - 1) / SNAP_CHUNK;
+    if (last >= st->dirty_cap) {
+        size_t ncap = st->dirty_cap ? st->dirty_cap : 64;
+        while (ncap <= last) ncap *= 2;
+        uint8_t* nd = (uint8_t*)realloc(st->dirty, ncap);
+        if (!nd) die_cleanup("Out of memory");
+        memset(nd + st->dirty_cap, 0, ncap - st->dirty_cap);
+        st->dirty = nd;
+        st->dirty_cap = ncap;
+    }
+    for (size_t c = a / SNAP_CHUNK; c <= last; ++c) st->dirty[c] = 1;
+}
+
+static void snap_free(Snapshot* s) {
+    for (size_t c = 0; c < s->nchunks; ++c)
+        if (--s->chunk[c]->refs == 0) free(s->chunk[c]);
+    free(s->chunk);
+    free(s);
+}
+
+/* Free retired versions that no reader can still be using */
+static void snap_reclaim(SnapStore* st) {
+    uint64_t oldest = (uint64_t)-1;
+    for (int r = 0; r < SNAP_READERS; ++r) {
+        uint64_t e = __atomic_load_n(&st->reader[r], __ATOMIC_SEQ_CST);
+        if (e && e < oldest) oldest = e;
+    }
+    Snapshot** p = &st->retired;
+    while (*p) {
+        if ((*p)->retired < oldest) { Snapshot* s = *p; *p = s->next; snap_free(s); }
+        else p = &(*p)->next;
+    }
+}
+
+/* Publish the current rows of v as the version new readers get */
+static void snap_publish(SnapStore* st, const RowVec* v) {
+    Snapshot* old = st->cur;
+    int clean = old && old->len == v->len && st->dirty_from == (size_t)-1;
+    for (size_t c = 0; clean && c < st->dirty_cap; ++c) clean = !st->dirty[c];
+    if (clean) return;
+
+    Snapshot* s = (Snapshot*)calloc(1, sizeof(Snapshot));
+    if (!s) die_cleanup("Out of memory");
+    s->version = ++st->published;
+    s->len = v->len;
+    s->nchunks = (v->len + SNAP_CHUNK - 1) / SNAP_CHUNK;
+    s->chunk = (SnapChunk**)malloc((s->nchunks ? s->nchunks : 1) * sizeof(SnapChunk*));
+    if (!s->chunk) die_cleanup("Out of memory");
+    for (size_t c = 0; c < s->nchunks; ++c) {
+        size_t a = c * SNAP_CHUNK, n = v->len - a < SNAP_CHUNK ? v->len - a : SNAP_CHUNK;
+        int dirty = c >= st->dirty_from || (c < st->dirty_cap && st->dirty[c]);
+        if (old && c < old->nchunks && !dirty && old->chunk[c]->n == n) {
+            s->chunk[c] = old->chunk[c];
+            s->chunk[c]->refs++;
+            continue;
+        }
+        SnapChunk* ch = (SnapChunk*)malloc(sizeof(SnapChunk) + n * sizeof(Row));
+        if (!ch) die_cleanup("Out of memory");
+        ch->refs = 1;
+        ch->gen = s->version;
+        ch->n = n;
+        memcpy(ch->row, &v->data[a], n * sizeof(Row));
+        s->chunk[c] = ch;
+    }
+    if (st->dirty) memset(st->dirty, 0, st->dirty_cap);
+    st->dirty_from = (size_t)-1;
+
+    __atomic_store_n(&st->cur, s, __ATOMIC_SEQ_CST);
+    if (old) {
+        /* readers that entered before the bump may hold old */
+        old->retired = __atomic_fetch_add(&st->epoch, 1, __ATOMIC_SEQ_CST);
+        old->next = st->retired;
+        st->retired = old;
+    }
+    snap_reclaim(st);
+}
+
+/* Enter a read section and get the published version, or NULL when
+   every reader slot is taken. Never blocks. */
+static const Snapshot* snap_acquire(SnapStore* st, int* slot) {
+    uint64_t e = __atomic_load_n(&st->epoch, __ATOMIC_SEQ_CST);
+    for (int r = 0; r < SNAP_READERS; ++r) {
+        uint64_t idle = 0;
+        if (__atomic_compare_exchange_n(&st->reader[r], &idle, e, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+            *slot = r;
+            return __atomic_load_n(&st->cur, __ATOMIC_SEQ_CST);
+        }
+    }
+    return NULL;
+}
+
+static void snap_release(SnapStore* st, int slot) {
+    __atomic_store_n(&st->reader[slot], 0, __ATOMIC_SEQ_CST);
+}
+
+/* Writer teardown, after every reader has finished */
+static void snap_destroy(SnapStore* st) {
+    if (st->cur) snap_free(st->cur);
+    while (st->retired) { Snapshot* s = st->retired; st->retired = s->next; snap_free(s); }
+    free(st->dirty);
+    snap_init(st);
+}
+
+/* ---------------------------------------------------------------------------
+ * Synthetic datasets for load testing (--gen N and friends).
+ * Each row is derived only from (seed, row index), so the data is identical
+ * whatever the thread count, and workers fill disjoint slices of a
+ * preallocated RowVec directly.
+ * --------------------------------------------------------------------------- */
+enum { GEN_IDS_DENSE, GEN_IDS_SPARSE, GEN_IDS_DUP };
+
+#define GEN_CHUNK 65536
+
+typedef struct {
+    size_t   rows;
+    int      name_min, name_max;     /* name length, uniform in [min, max] */
+    unsigned status_w[3];            /* weights for Active, Pending, Paused */
+    int      ids;                    /* GEN_IDS_* */
+    uint64_t seed;
+} GenSpec;
+
+static const char* const gen_status[3] = { "Active", "Pending", "Paused" };
+
+/* Active -> Pending -> Paused -> Active; anything else becomes Active */
+static const char* status_next(const char* s) {
+    for (int k = 0; k < 3; ++k)
+        if (strcmp(s, gen_status[k]) == 0) return gen_status[(k + 1) % 3];
+    return gen_status[0];
+}
+
+static void gen_spec_init(GenSpec* g) {
+    g->rows = 0;
+    g->name_min = 6;
+    g->name_max = 18;
+    g->status_w[0] = g->status_w[1] = g->status_w[2] = 1;
+    g->ids = GEN_IDS_DENSE;
+    g->seed = 1;
+}
+
+/* Apply one --name-len/--status-mix/--ids/--seed option. 0 or -1. */
+static int gen_spec_option(GenSpec* g, const char* opt, const char* val) {
+    if (strcmp(opt, "--name-len") == 0) {
+        int a, b;
+        if (sscanf(val, "%d:%d", &a, &b) != 2 || a < 1 || b < a || b > (int)sizeof(((Row*)0)->name) - 1) return -1;
+        g->name_min = a; g->name_max = b;
+    } else if (strcmp(opt, "--status-mix") == 0) {
+        unsigned a, p, x;
+        if (sscanf(val, "%u:%u:%u", &a, &p, &x) != 3 || a + p + x == 0) return -1;
+        g->status_w[0] = a; g->status_w[1] = p; g->status_w[2] = x;
+    } else if (strcmp(opt, "--ids") == 0) {
+        if      (strcmp(val, "dense") == 0)  g->ids = GEN_IDS_DENSE;
+        else if (strcmp(val, "sparse") == 0) g->ids = GEN_IDS_SPARSE;
+        else if (strcmp(val, "dup") == 0)    g->ids = GEN_IDS_DUP;
+        else return -1;
+    } else if (strcmp(opt, "--seed") == 0) {
+        g->seed = strtoull(val, NULL, 10);
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+static uint64_t splitmix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+/* 0 if every id for g->rows rows fits an int, else -1 */
+static int gen_spec_check(const GenSpec* g) {
+    uint64_t rows = (uint64_t)g->rows;
+    switch (g->ids) {
+        case GEN_IDS_DENSE:  return rows <= INT_MAX ? 0 : -1;
+        case GEN_IDS_SPARSE: return rows <= INT_MAX / 8 ? 0 : -1;     /* i * 8 + 8 */
+        default:             return rows / 4 + 1 <= INT_MAX ? 0 : -1;
+    }
+}
+
+static void gen_spec_row(const GenSpec* g, size_t i, Row* r) {
+    uint64_t s = g->seed * 0x100000001b3ull ^ (uint64_t)i;
+    uint64_t x = splitmix64(s);
+    memset(r, 0, sizeof(*r));
+
+    switch (g->ids) {
+        case GEN_IDS_DENSE:  r->id = (int)(i + 1); break;
+        case GEN_IDS_SPARSE: r->id = (int)(i * 8 + (x & 7) + 1); break;       /* increasing, gaps */
+        default:             r->id = (int)(1 + (x >> 32) % (g->rows / 4 + 1)); break;  /* ~4 per id */
+    }
+
+    unsigned tw = g->status_w[0] + g->status_w[1] + g->status_w[2];
+    unsigned pick = (unsigned)((x >> 8) % tw);
+    int st = (pick < g->status_w[0]) ? 0 : (pick < g->status_w[0] + g->status_w[1]) ? 1 : 2;
+    memcpy(r->status, gen_status[st], strlen(gen_status[st]));
+
+    /* Letters drawn 5 bits at a time; a space roughly every 7 characters */
+    x = splitmix64(s ^ 0xa5a5a5a5a5a5a5a5ull);
+    int len = g->name_min + (int)(x % (uint64_t)(g->name_max - g->name_min + 1));
+    int bits = 0;
+    for (int k = 0; k < len; ++k) {
+        if (bits < 5) { x = splitmix64(x); bits = 64; }
+        unsigned v = (unsigned)(x & 31);
+        x >>= 5; bits -= 5;
+        if (k > 0 && k < len - 1 && r->name[k-1] != ' ' && v >= 28) r->name[k] = ' ';
+        else r->name[k] = (char)((k == 0 || r->name[k-1] == ' ') ? 'A' + v % 26 : 'a' + v % 26);
+    }
+}
+
+/* Extra columns: ints in [0, 1e6), doubles in [0, 10000) with cents,
+   dict values from a GEN_DICT_VALUES vocabulary interned up front, and
+   short strings in fixed GEN_STR_STRIDE slots so workers never share the
+   string heap's append point. */
+#define GEN_DICT_VALUES 16
+#define GEN_STR_STRIDE  16
+
+static void gen_extra_cell(ColStore* c, size_t i, uint64_t x) {
+    switch (c->type) {
+        case CT_INT64:  col_i64(c)[i] = (int64_t)(x % 1000000); break;
+        case CT_DOUBLE: col_f64(c)[i] = (double)(x % 1000000) / 100.0; break;
+        case CT_DICT:   col_code(c)[i] = 1 + (uint32_t)(x % GEN_DICT_VALUES); break;
+        case CT_STR: {
+            uint64_t off = 1 + (uint64_t)i * GEN_STR_STRIDE;
+            char* p = c->heap.buf + off;
+            int len = 4 + (int)(x % (GEN_STR_STRIDE - 4));
+            x >>= 4;
+            for (int k = 0; k < len; ++k, x >>= 5) p[k] = (char)('a' + (x & 31) % 26);
+            p[len] = '\0';
+            col_off(c)[i] = off;
+        } break;
+    }
+}
+
+typedef struct {
+    const GenSpec* g;
+    RowVec*        v;
+} GenJob;
+
+static void gen_fill_chunk(void* ctx, size_t c) {
+    const GenSpec* g = ((GenJob*)ctx)->g;
+    RowVec* v = ((GenJob*)ctx)->v;
+    size_t lo = c * GEN_CHUNK, hi = (lo + GEN_CHUNK < g->rows) ? lo + GEN_CHUNK : g->rows;
+    for (size_t i = lo; i < hi; ++i) {
+        gen_spec_row(g, i, &v->data[i]);
+        for (int e = 0; e < v->nextra; ++e)
+            gen_extra_cell(&v->extra[e], i, splitmix64(g->seed * 0x100000001b3ull ^ (uint64_t)i ^ ((uint64_t)(e + 1) << 56)));
+    }
+}
+
+/* Replace v's contents with g->rows generated rows */
+static void gen_fill(const GenSpec* g, RowVec* v) {
+    GenJob job = { g, v };
+    v->len = 0;
+    vec_reserve(v, g->rows);
+    for (int e = 0; e < v->nextra; ++e) {
+        ColStore* c = &v->extra[e];
+        if (c->type == CT_DICT) {
+            for (int k = 1; k <= GEN_DICT_VALUES; ++k) {
+                char val[48];
+                snprintf(val, sizeof(val), "%s-%d", g_schema.col[BUILTIN_COLS + e].name, k);
+                dict_intern(&c->dict, val);
+            }
+        } else if (c->type == CT_STR) {
+            heap_reserve(&c->heap, 1 + g->rows * GEN_STR_STRIDE);
+            c->heap.len = 1 + g->rows * GEN_STR_STRIDE;
+        }
+    }
+    par_for((g->rows + GEN_CHUNK - 1) / GEN_CHUNK, gen_fill_chunk, &job);
+    v->len = g->rows;
+}
+
+/* ---------------------------------------------------------------------------
+ * Instrumentation: per-operation latency histograms.
+ * span_begin()/span_end() bracket a hot path. Samples land in log-linear
+ * buckets (8 per power of two, ~12% resolution, like an HDR histogram)
+ * updated with relaxed atomics, so any thread may record and the overlay
+ * may read while they do. When timings are off, a span costs one load and
+ * a branch.
+ * --------------------------------------------------------------------------- */
+enum { SPAN_DRAW, SPAN_INPUT, SPAN_EDIT, SPAN_EXPORT, SPAN_SAVE, SPAN_MEMINFO, SPAN_GEN, SPAN_FOLLOW, SPAN_COUNT };
+static const char* const span_names[SPAN_COUNT] = { "draw", "input", "edit", "export", "save", "meminfo", "generate", "follow" };
+
+#define PROF_SUB     8                       /* sub-buckets per power of two */
+#define PROF_BUCKETS ((64 - 2) * PROF_SUB)
+
+typedef struct {
+    uint64_t count;
+    uint64_t sum_ns;
+    uint64_t max_ns;
+    uint64_t bucket[PROF_BUCKETS];
+} Hist;
+
+static int  g_prof_on;                       /* recording enabled */
+static int  g_prof_waited;                   /* a modal waited for the user */
+static Hist g_hist[SPAN_COUNT];
+
+static uint64_t prof_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static unsigned prof_bucket(uint64_t v) {
+    if (v < PROF_SUB) return (unsigned)v;
+    unsigned msb = 63u - (unsigned)__builtin_clzll(v);
+    return (msb - 2) * PROF_SUB + (unsigned)((v >> (msb - 3)) & (PROF_SUB - 1));
+}
+
+/* Largest value that falls in bucket b */
+static uint64_t prof_bucket_max(unsigned b) {
+    if (b < PROF_SUB) return b;
+    unsigned msb = b / PROF_SUB + 2, sub = b % PROF_SUB;
+    return ((uint64_t)(PROF_SUB + sub + 1) << (msb - 3)) - 1;
+}
+
+static void prof_record(int span, uint64_t ns) {
+    Hist* h = &g_hist[span];
+    __atomic_fetch_add(&h->count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->sum_ns, ns, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->bucket[prof_bucket(ns)], 1, __ATOMIC_RELAXED);
+    uint64_t m = __atomic_load_n(&h->max_ns, __ATOMIC_RELAXED);
+    while (ns > m && !__atomic_compare_exchange_n(&h->max_ns, &m, ns, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}
+}
+
+static uint64_t span_begin(void) { return g_prof_on ? prof_now_ns() : 0; }
+
+static void span_end(int span, uint64_t t0) {
+    if (t0) prof_record(span, prof_now_ns() - t0);
+}
+
+/* Value at quantile q (0..1): its bucket's upper bound, capped at max */
+static uint64_t prof_quantile(const Hist* h, double q) {
+    uint64_t n = __atomic_load_n(&h->count, __ATOMIC_RELAXED);
+    uint64_t max = __atomic_load_n(&h->max_ns, __ATOMIC_RELAXED);
+    if (n == 0) return 0;
+    uint64_t want = (uint64_t)(q * (double)n + 0.5), seen = 0;
+    if (want < 1) want = 1;
+    for (unsigned b = 0; b < PROF_BUCKETS; ++b) {
+        seen += __atomic_load_n(&h->bucket[b], __ATOMIC_RELAXED);
+        if (seen >= want) return prof_bucket_max(b) < max ? prof_bucket_max(b) : max;
+    }
+    return max;
+}
+
+static const char* human_ns(uint64_t ns, char* out, size_t n) {
+    if (ns < 1000)          snprintf(out, n, "%lluns", (unsigned long long)ns);
+    else if (ns < 1000000)  snprintf(out, n, "%.1fus", ns / 1e3);
+    else if (ns < 1000000000ull) snprintf(out, n, "%.1fms", ns / 1e6);
+    else                    snprintf(out, n, "%.2fs", ns / 1e9);
+    return out;
+}
+
+static void default_timings_path(char* out, size_t n) {
+    time_t t = time(NULL); struct tm tmv;
+    localtime_r(&t, &tmv);
+    strftime(out, n, "itable_timings_%Y%m%d_%H%M%S.txt", &tmv);
+}
+
+/* Summary plus the non-empty buckets of every span. Returns 0 or errno. */
+static int write_timings(const char* path) {
+    FILE* f = fopen(path, "w");
+    if (!f) return errno;
+    fprintf(f, "%-8s %10s %12s %12s %12s %12s %12s\n", "span", "count", "mean_ns", "p50_ns", "p99_ns", "p999_ns", "max_ns");
+    for (int s = 0; s < SPAN_COUNT; ++s) {
+        const Hist* h = &g_hist[s];
+        uint64_t n = __atomic_load_n(&h->count, __ATOMIC_RELAXED);
+        fprintf(f, "%-8s %10llu %12llu %12llu %12llu %12llu %12llu\n", span_names[s],
+                (unsigned long long)n,
+                (unsigned long long)(n ? __atomic_load_n(&h->sum_ns, __ATOMIC_RELAXED) / n : 0),
+                (unsigned long long)prof_quantile(h, 0.50),
+                (unsigned long long)prof_quantile(h, 0.99),
+                (unsigned long long)prof_quantile(h, 0.999),
+                (unsigned long long)__atomic_load_n(&h->max_ns, __ATOMIC_RELAXED));
+    }
+    for (int s = 0; s < SPAN_COUNT; ++s) {
+        fprintf(f, "\n# %s: bucket_max_ns count\n", span_names[s]);
+        for (unsigned b = 0; b < PROF_BUCKETS; ++b) {
+            uint64_t c = __atomic_load_n(&g_hist[s].bucket[b], __ATOMIC_RELAXED);
+            if (c) fprintf(f, "%llu %llu\n", (unsigned long long)prof_bucket_max(b), (unsigned long long)c);
+        }
+    }
+    return fclose(f) == 0 ? 0 : errno;
+}
+
+/* ---------------------------------------------------------------------------
+ * Asynchronous file I/O pipeline used by CSV load and export.
+ * IO_DEPTH requests of IO_CHUNK bytes are kept in flight so the device
+ * stays busy while the CPU parses/formats the previous chunk. Linux uses
+ * io_uring (raw syscalls, no liburing); elsewhere, or if io_uring_setup()
+ * fails or ITABLE_NO_URING is set, a small pool of pread/pwrite threads
+ * provides the same submit/wait interface.
+ * --------------------------------------------------------------------------- */
+#define IO_CHUNK (4u << 20)
+#define IO_DEPTH 4
+
+typedef struct {
+    int     slot;       /* caller's buffer slot, echoed on completion */
+    int     write;
+    int     fd;
+    void*   buf;
+    size_t  len;
+    off_t   off;
+    ssize_t res;        /* bytes, or -errno */
+} AioReq;
+
+#ifdef ITABLE_HAVE_URING
+typedef struct {
+    int       fd;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe* sqes;
+    struct io_uring_cqe* cqes;
+    void*     sq_ptr;  size_t sq_sz;
+    void*     cq_ptr;  size_t cq_sz;
+    size_t    sqes_sz;
+} Uring;
+
+static int uring_open(Uring* u, unsigned entries) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    memset(u, 0, sizeof(*u));
+    u->fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+    if (u->fd < 0) return -1;
+
+    u->sq_sz = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    u->cq_sz = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (u->cq_sz > u->sq_sz) u->sq_sz = u->cq_sz;
+        u->cq_sz = u->sq_sz;
+    }
+    u->sq_ptr = mmap(NULL, u->sq_sz, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, u->fd, IORING_OFF_SQ_RING);
+    if (u->sq_ptr == MAP_FAILED) { close(u->fd); return -1; }
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        u->cq_ptr = u->sq_ptr;
+    } else {
+        u->cq_ptr = mmap(NULL, u->cq_sz, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, u->fd, IORING_OFF_CQ_RING);
+        if (u->cq_ptr == MAP_FAILED) { munmap(u->sq_ptr, u->sq_sz); close(u->fd); return -1; }
+    }
+    u->sqes_sz = p.sq_entries * sizeof(struct io_uring_sqe);
+    u->sqes = (struct io_uring_sqe*)mmap(NULL, u->sqes_sz, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, u->fd, IORING_OFF_SQES);
+    if (u->sqes == MAP_FAILED) {
+        if (u->cq_ptr != u->sq_ptr) munmap(u->cq_ptr, u->cq_sz);
+        munmap(u->sq_ptr, u->sq_sz); close(u->fd); return -1;
+    }
+
+    char* sq = (char*)u->sq_ptr;
+    char* cq = (char*)u->cq_ptr;
+    u->sq_head  = (unsigned*)(sq + p.sq_off.head);
+    u->sq_tail  = (unsigned*)(sq + p.sq_off.tail);
+    u->sq_mask  = (unsigned*)(sq + p.sq_off.ring_mask);
+    u->sq_array = (unsigned*)(sq + p.sq_off.array);
+    u->cq_head  = (unsigned*)(cq + p.cq_off.head);
+    u->cq_tail  = (unsigned*)(cq + p.cq_off.tail);
+    u->cq_mask  = (unsigned*)(cq + p.cq_off.ring_mask);
+    u->cqes     = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+    return 0;
+}
+
+static int uring_submit(Uring* u, const AioReq* r) {
+    unsigned tail = *u->sq_tail;
+    unsigned idx = tail & *u->sq_mask;
+    struct io_uring_sqe* sqe = &u->sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode    = r->write ? IORING_OP_WRITE : IORING_OP_READ;
+    sqe->fd        = r->fd;
+    sqe->addr      = (unsigned long long)(uintptr_t)r->buf;
+    sqe->len       = (unsigned)r->len;
+    sqe->off       = (unsigned long long)r->off;
+    sqe->user_data = (unsigned long long)r->slot;
+    u->sq_array[idx] = idx;
+    __atomic_store_n(u->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    for (;;) {
+        long n = syscall(__NR_io_uring_enter, u->fd, 1, 0, 0, NULL, 0);
+        if (n > 0) return 0;
+        if (n < 0 && errno == EINTR) continue;
+        int e = n < 0 ? errno : EAGAIN;
+        if (__atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE) != tail) return 0;   /* taken after all */
+        __atomic_store_n(u->sq_tail, tail, __ATOMIC_RELEASE);                 /* withdraw the SQE */
+        errno = e;
+        return -1;
+    }
+}
+
+static int uring_wait(Uring* u, int* slot, ssize_t* res) {
+    for (;;) {
+        unsigned head = *u->cq_head;
+        if (head != __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE)) {
+            struct io_uring_cqe* cqe = &u->cqes[head & *u->cq_mask];
+            *slot = (int)cqe->user_data;
+            *res  = cqe->res;
+            __atomic_store_n(u->cq_head, head + 1, __ATOMIC_RELEASE);
+            return 0;
+        }
+        if (syscall(__NR_io_uring_enter, u->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0 && errno != EINTR)
+            return -1;
+    }
+}
+
+static void uring_close(Uring* u) {
+    munmap(u->sqes, u->sqes_sz);
+    if (u->cq_ptr != u->sq_ptr) munmap(u->cq_ptr, u->cq_sz);
+    munmap(u->sq_ptr, u->sq_sz);
+    close(u->fd);
+}
+#endif /* ITABLE_HAVE_URING */
+
+/* Thread-pool fallback: IO_DEPTH workers doing blocking pread/pwrite */
+typedef struct {
+    pthread_t       th[IO_DEPTH];
+    pthread_mutex_t mu;
+    pthread_cond_t  cv_sub, cv_done;
+    AioReq          sub[IO_DEPTH], done[IO_DEPTH];
+    int             nsub, ndone, stop;
+} IoPool;
+
+static void* iopool_main(void* arg) {
+    IoPool* p = (IoPool*)arg;
+    pthread_mutex_lock(&p->mu);
+    for (;;) {
+        while (!p->stop && p->nsub == 0) pthread_cond_wait(&p->cv_sub, &p->mu);
+        if (p->nsub == 0) break;
+        AioReq r = p->sub[--p->nsub];
+        pthread_mutex_unlock(&p->mu);
+        do {
+            r.res = r.write ? pwrite(r.fd, r.buf, r.len, r.off) : pread(r.fd, r.buf, r.len, r.off);
+        } while (r.res < 0 && errno == EINTR);
+        if (r.res < 0) r.res = -errno;
+        pthread_mutex_lock(&p->mu);
+        p->done[p->ndone++] = r;
+        pthread_cond_signal(&p->cv_done);
+    }
+    pthread_mutex_unlock(&p->mu);
+    return NULL;
+}
+
+typedef struct {
+    int    use_uring;
+    int    inflight;
+#ifdef ITABLE_HAVE_URING
+    Uring  ring;
+    AioReq sync[IO_DEPTH];      /* done synchronously after a failed submit */
+    int    nsync;
+#endif
+    IoPool pool;
+} Aio;
+
+static int aio_open(Aio* a) {
+    memset(a, 0, sizeof(*a));
+#ifdef ITABLE_HAVE_URING
+    if (!getenv("ITABLE_NO_URING") && uring_open(&a->ring, IO_DEPTH * 2) == 0) {
+        a->use_uring = 1;
+        return 0;
+    }
+#endif
+    IoPool* p = &a->pool;
+    pthread_mutex_init(&p->mu, NULL);
+    pthread_cond_init(&p->cv_sub, NULL);
+    pthread_cond_init(&p->cv_done, NULL);
+    for (int i = 0; i < IO_DEPTH; ++i) {
+        if (pthread_create(&p->th[i], NULL, iopool_main, p) == 0) continue;
+        pthread_mutex_lock(&p->mu);                /* stop the workers already started */
+        p->stop = 1;
+        pthread_cond_broadcast(&p->cv_sub);
+        pthread_mutex_unlock(&p->mu);
+        while (i-- > 0) pthread_join(p->th[i], NULL);
+        pthread_mutex_destroy(&p->mu);
+        pthread_cond_destroy(&p->cv_sub);
+        pthread_cond_destroy(&p->cv_done);
+        return -1;
+    }
+    return 0;
+}
+
+/* Queue one request; at most IO_DEPTH may be in flight. If io_uring
+   refuses it (EAGAIN, EBUSY), it is done right away with pread/pwrite
+   and its completion is handed out by the next aio_wait. */
+static int aio_submit(Aio* a, const AioReq* r) {
+    a->inflight++;
+#ifdef ITABLE_HAVE_URING
+    if (a->use_uring) {
+        if (uring_submit(&a->ring, r) == 0) return 0;
+        if (a->nsync == IO_DEPTH) { a->inflight--; return -1; }
+        AioReq d = *r;
+        do {
+            d.res = d.write ? pwrite(d.fd, d.buf, d.len, d.off) : pread(d.fd, d.buf, d.len, d.off);
+        } while (d.res < 0 && errno == EINTR);
+        if (d.res < 0) d.res = -errno;
+        a->sync[a->nsync++] = d;
+        return 0;
+    }
+#endif
+    pthread_mutex_lock(&a->pool.mu);
+    a->pool.sub[a->pool.nsub++] = *r;
+    pthread_cond_signal(&a->pool.cv_sub);
+    pthread_mutex_unlock(&a->pool.mu);
+    return 0;
+}
+
+/* Block until any request completes. */
+static int aio_wait(Aio* a, int* slot, ssize_t* res) {
+    a->inflight--;
+#ifdef ITABLE_HAVE_URING
+    if (a->use_uring && a->nsync) {
+        const AioReq* d = &a->sync[--a->nsync];
+        *slot = d->slot;
+        *res  = d->res;
+        return 0;
+    }
+    if (a->use_uring) return uring_wait(&a->ring, slot, res);
+#endif
+    pthread_mutex_lock(&a->pool.mu);
+    while (a->pool.ndone == 0) pthread_cond_wait(&a->pool.cv_done, &a->pool.mu);
+    AioReq r = a->pool.done[--a->pool.ndone];
+    pthread_mutex_unlock(&a->pool.mu);
+    *slot = r.slot;
+    *res  = r.res;
+    return 0;
+}
+
+/* Drains outstanding requests, then releases the backend. */
+static void aio_close(Aio* a) {
+    int slot; ssize_t res;
+    while (a->inflight > 0) aio_wait(a, &slot, &res);
+#ifdef ITABLE_HAVE_URING
+    if (a->use_uring) { uring_close(&a->ring); return; }
+#endif
+    IoPool* p = &a->pool;
+    pthread_mutex_lock(&p->mu);
+    p->stop = 1;
+    pthread_cond_broadcast(&p->cv_sub);
+    pthread_mutex_unlock(&p->mu);
+    for (int i = 0; i < IO_DEPTH; ++i) if (p->th[i]) pthread_join(p->th[i], NULL);
+    pthread_mutex_destroy(&p->mu);
+    pthread_cond_destroy(&p->cv_sub);
+    pthread_cond_destroy(&p->cv_done);
+}
+
+/* Account for a completed write of slot `done`. A short write is
+   resubmitted for the rest of its chunk and the slot stays busy.
+   Returns 0 or errno. */
+static int aio_write_done(Aio* a, AioReq* pend, int* busy, int done, ssize_t res) {
+    AioReq* r = &pend[done];
+    if (res > 0 && (size_t)res < r->len) {
+        r->buf = (char*)r->buf + res;
+        r->len -= (size_t)res;
+        r->off += (off_t)res;
+        if (aio_submit(a, r) == 0) return 0;
+        busy[done] = 0;
+        return errno ? errno : EIO;
+    }
+    busy[done] = 0;
+    if (res < 0) return (int)-res;
+    return (size_t)res == r->len ? 0 : EIO;      /* no progress at all */
+}
+
+/* ---------------------------------------------------------------------------
+ * CSV load / export (ID,Name,Status; RFC 4180 quoting)
+ * --------------------------------------------------------------------------- */
+static void default_export_path(char* out, size_t n) {
+    time_t t = time(NULL); struct tm tmv;
+    localtime_r(&t, &tmv);
+    strftime(out, n, "table_export_%Y%m%d_%H%M%S.csv", &tmv);
+}
+
+static void csv_escape(const char* in, char* out, size_t outsz) {
+    int needs = 0;
+    for (const char* p = in; *p; p++)
+        if (*p==','||*p=='"'||*p=='\n'||*p=='\r') { needs = 1; break; }
+    if (!needs) { snprintf(out, outsz, "%s", in); return; }
+    size_t w = 0; out[w++] = '"';
+    for (const char* p = in; *p && w + 3 < outsz; p++) {
+        if (*p == '"') { out[w++] = '"'; out[w++] = '"'; }
+        else out[w++] = *p;
+    }
+    out[w++] = '"'; out[w] = '\0';
+}
+
+/* Copy the next CSV field of s[*pos..n) into out, unquoting. */
+static void csv_field(const char* s, size_t n, size_t* pos, char* out, size_t outsz) {
+    size_t i = *pos, w = 0;
+    if (i < n && s[i] == '"') {
+        for (++i; i < n; ++i) {
+            if (s[i] == '"') {
+                if (i + 1 < n && s[i+1] == '"') { if (w + 1 < outsz) out[w++] = '"'; ++i; }
+                else { ++i; break; }
+            } else if (w + 1 < outsz) out[w++] = s[i];
+        }
+        while (i < n && s[i] != ',') ++i;
+    } else {
+        for (; i < n && s[i] != ','; ++i) if (w + 1 < outsz) out[w++] = s[i];
+    }
+    out[w] = '\0';
+    *pos = (i < n) ? i + 1 : n;
+}
+
+#define CSV_FIELD_MAX 1024     /* longest extra-column value kept on load */
+
+/* Parse the built-in fields of one record (no line terminator); *pos is
+   left at the first extra field. Returns 0 for a data row, -1 for the
+   header or anything without a numeric ID. */
+static int csv_parse_row(const char* s, size_t n, Row* r, size_t* pos_out) {
+    char idbuf[32];
+    size_t pos = 0;
+    csv_field(s, n, &pos, idbuf, sizeof(idbuf));
+    char* end = NULL;
+    long id = strtol(idbuf, &end, 10);
+    if (end == idbuf || *end) return -1;
+    r->id = (int)id;
+    csv_field(s, n, &pos, r->name, sizeof(r->name));
+    csv_field(s, n, &pos, r->status, sizeof(r->status));
+    *pos_out = pos;
+    return 0;
+}
+
+/* A header with more than the built-in fields defines extra columns
+   (as strings) unless --schema already did. */
+static void csv_header(RowVec* v, const char* s, size_t n) {
+    char field[CSV_FIELD_MAX];
+    size_t pos = 0;
+    if (g_schema.ncols != BUILTIN_COLS) return;
+    for (int k = 0; pos < n; ++k) {
+        csv_field(s, n, &pos, field, sizeof(field));
+        if (k >= BUILTIN_COLS && schema_add_column(v, field, CT_STR, 0) != 0) break;
+    }
+}
+
+/* Splits chunks into records (quote-aware) and appends parsed rows. */
+typedef struct {
+    RowVec* v;
+    char*   carry;      /* partial record spanning chunk boundaries */
+    size_t  carry_len, carry_cap;
+    int     in_quote;
+    size_t  records;    /* records seen, to spot the header */
+} CsvParser;
+
+static int csv_carry(CsvParser* cp, const char* s, size_t n) {
+    if (cp->carry_len + n > cp->carry_cap) {
+        size_t ncap = cp->carry_cap ? cp->carry_cap * 2 : 256;
+        while (ncap < cp->carry_len + n) ncap *= 2;
+        char* nb = (char*)realloc(cp->carry, ncap);
+        if (!nb) return ENOMEM;
+        cp->carry = nb; cp->carry_cap = ncap;
+    }
+    memcpy(cp->carry + cp->carry_len, s, n);
+    cp->carry_len += n;
+    return 0;
+}
+
+static void csv_emit(CsvParser* cp, const char* s, size_t n) {
+    Row r;
+    size_t pos;
+    if (n && s[n-1] == '\r') n--;
+    if (!n) return;
+    if (csv_parse_row(s, n, &r, &pos) != 0) {
+        if (cp->records++ == 0) csv_header(cp->v, s, n);
+        return;
+    }
+    cp->records++;
+    vec_push(cp->v, r);
+    for (int c = 0; c < cp->v->nextra; ++c) {             /* missing fields stay empty */
+        char field[CSV_FIELD_MAX];
+        csv_field(s, n, &pos, field, sizeof(field));
+        col_set_text(&cp->v->extra[c], cp->v->len - 1, field);
+    }
+}
+
+static int csv_feed(CsvParser* cp, const char* buf, size_t n) {
+    size_t start = 0;
+    for (size_t i = 0; i < n; ++i) {
+        char c = buf[i];
+        if (c == '"') cp->in_quote = !cp->in_quote;
+        else if (c == '\n' && !cp->in_quote) {
+            if (cp->carry_len) {
+                if (csv_carry(cp, buf + start, i - start)) return ENOMEM;
+                csv_emit(cp, cp->carry, cp->carry_len);
+                cp->carry_len = 0;
+            } else {
+                csv_emit(cp, buf + start, i - start);
+            }
+            start = i + 1;
+        }
+    }
+    return csv_carry(cp, buf + start, n - start);
+}
+
+/* Load a CSV file, appending rows to v. Reads IO_DEPTH chunks ahead of
+   the parser. Returns 0 or errno. */
+static int load_csv(const char* path, RowVec* v) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return errno;
+    struct stat st;
+    if (fstat(fd, &st) != 0) { int e = errno; close(fd); return e; }
+    off_t size = st.st_size;
+
+    char* bufs = (char*)malloc((size_t)IO_DEPTH * IO_CHUNK);
+    Aio aio;
+    if (!bufs || aio_open(&aio) != 0) { free(bufs); close(fd); return ENOMEM; }
+    vec_reserve(v, v->len + (size_t)(size / 24) + 1);   /* rough rows-per-byte guess */
+
+    /* chunk k lives in slot k % IO_DEPTH; filled[] counts bytes landed */
+    off_t  next_off = 0;
+    size_t want[IO_DEPTH], filled[IO_DEPTH];
+    off_t  base[IO_DEPTH];
+    int    err = 0;
+    for (int s = 0; s < IO_DEPTH && next_off < size; ++s) {
+        base[s] = next_off;
+        want[s] = (size - next_off < (off_t)IO_CHUNK) ? (size_t)(size - next_off) : IO_CHUNK;
+        filled[s] = 0;
+        AioReq r = { s, 0, fd, bufs + (size_t)s * IO_CHUNK, want[s], base[s], 0 };
+        if (aio_submit(&aio, &r) != 0) { err = errno ? errno : EIO; break; }
+        next_off += (off_t)want[s];
+    }
+
+    CsvParser cp = { v, NULL, 0, 0, 0, 0 };
+    int expect = 0;                   /* slot holding the next chunk in file order */
+    int ready[IO_DEPTH] = { 0 };
+    while (aio.inflight > 0 && !err) {
+        int slot; ssize_t res;
+        if (aio_wait(&aio, &slot, &res) != 0) { err = errno; break; }
+        if (res < 0) { err = (int)-res; break; }
+        if (res == 0) { err = EIO; break; }
+        filled[slot] += (size_t)res;
+        if (filled[slot] < want[slot]) {          /* short read: fetch the rest */
+            AioReq r = { slot, 0, fd, bufs + (size_t)slot * IO_CHUNK + filled[slot],
+                         want[slot] - filled[slot], base[slot] + (off_t)filled[slot], 0 };
+            if (aio_submit(&aio, &r) != 0) { err = errno ? errno : EIO; break; }
+            continue;
+        }
+        ready[slot] = 1;
+        /* parse every chunk that is now complete in order, refilling its slot */
+        while (ready[expect] && !err) {
+            ready[expect] = 0;
+            err = csv_feed(&cp, bufs + (size_t)expect * IO_CHUNK, want[expect]);
+            if (next_off < size) {
+                base[expect] = next_off;
+                want[expect] = (size - next_off < (off_t)IO_CHUNK) ? (size_t)(size - next_off) : IO_CHUNK;
+                filled[expect] = 0;
+                AioReq r = { expect, 0, fd, bufs + (size_t)expect * IO_CHUNK, want[expect], base[expect], 0 };
+                if (aio_submit(&aio, &r) != 0) { err = errno ? errno : EIO; break; }
+                next_off += (off_t)want[expect];
+            }
+            expect = (expect + 1) % IO_DEPTH;
+        }
+    }
+    if (!err && cp.carry_len) csv_emit(&cp, cp.carry, cp.carry_len);   /* no final newline */
+
+    aio_close(&aio);
+    free(cp.carry);
+    free(bufs);
+    close(fd);
+    return err;
+}
+
+/* Export v, or the snapshot snap when it is not NULL (ID/Name/Status
+   only), as CSV. Rows are formatted into one chunk while the previous
+   chunks are being written. Returns 0 or errno. */
+static int write_csv(const RowVec* v, const Snapshot* snap, const char* path) {
+    size_t rows = snap ? snap->len : v->len;
+    int nextra = snap ? 0 : v->nextra;
+    int fd = open(path, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+    if (fd < 0) return errno;
+    char* bufs = (char*)malloc((size_t)IO_DEPTH * IO_CHUNK);
+    size_t line_cap = 256 + (size_t)nextra * (2 * CSV_FIELD_MAX + 4);
+    char* line = (char*)malloc(line_cap);
+    Aio aio;
+    if (!bufs || !line || aio_open(&aio) != 0) { free(bufs); free(line); close(fd); return ENOMEM; }
+
+    int busy[IO_DEPTH] = { 0 };
+    AioReq pend[IO_DEPTH];
+    int slot = 0, err = 0;
+    size_t len = 0;
+    off_t off = 0;
+    char* out = bufs;
+    for (int c = 0; c < g_schema.ncols; ++c) {
+        char hbuf[80];
+        csv_escape(g_schema.col[c].name, hbuf, sizeof(hbuf));
+        len += (size_t)snprintf(out + len, IO_CHUNK - len, "%s%s", c ? "," : "", hbuf);
+    }
+    out[len++] = '\n';
+
+    for (size_t i = 0; i <= rows && !err; ++i) {
+        size_t n = 0;
+        if (i < rows) {
+            const Row* r = snap ? snap_row(snap, i) : &v->data[i];
+            char nbuf[160], sbuf[80];
+            csv_escape(r->name, nbuf, sizeof(nbuf));
+            csv_escape(r->status, sbuf, sizeof(sbuf));
+            n = (size_t)snprintf(line, line_cap, "%d,%s,%s", r->id, nbuf, sbuf);
+            for (int c = 0; c < nextra; ++c) {
+                const ColStore* cs = &v->extra[c];
+                line[n++] = ',';
+                if (cs->type == CT_INT64) {
+                    n += (size_t)fmt_i64(col_i64(cs)[i], line + n);
+                } else if (cs->type == CT_DOUBLE) {
+                    /* shortest form that reads back exactly, not the 2-decimal view */
+                    double d = col_f64(cs)[i];
+                    int k = snprintf(line + n, 32, "%.15g", d);
+                    if (strtod(line + n, NULL) != d) k = snprintf(line + n, 32, "%.17g", d);
+                    n += (size_t)k;
+                } else {
+                    char ebuf[2 * CSV_FIELD_MAX + 3];
+                    csv_escape(col_str(cs, i), ebuf, sizeof(ebuf));
+                    n += (size_t)snprintf(line + n, line_cap - n, "%s", ebuf);
+                }
+            }
+            line[n++] = '\n';
+        }
+        /* flush the current chunk when full, or at the end */
+        if (len + n > IO_CHUNK || (i == rows && len)) {
+            AioReq r = { slot, 1, fd, out, len, off, 0 };
+            pend[slot] = r;
+            busy[slot] = 1;
+            if (aio_submit(&aio, &r) != 0) { err = errno ? errno : EIO; busy[slot] = 0; }
+            off += (off_t)len;
+            len = 0;
+            slot = (slot + 1) % IO_DEPTH;
+            out = bufs + (size_t)slot * IO_CHUNK;
+            while (busy[slot] && !err) {          /* reuse: wait for its write */
+                int done; ssize_t res;
+                if (aio_wait(&aio, &done, &res) != 0) { err = errno; break; }
+                err = aio_write_done(&aio, pend, busy, done, res);
+            }
+        }
+        memcpy(out + len, line, n);
+        len += n;
+    }
+    while (aio.inflight > 0) {
+        int done; ssize_t res;
+        if (aio_wait(&aio, &done, &res) != 0) { if (!err) err = errno; break; }
+        if (!err) err = aio_write_done(&aio, pend, busy, done, res);
+    }
+
+    aio_close(&aio);
+    free(bufs);
+    free(line);
+    if (close(fd) != 0 && !err) err = errno;
+    return err;
+}
+
+/* CSV export on a worker thread, reading a snapshot so the UI can keep
+   editing the table meanwhile. */
+typedef struct {
+    SnapStore* st;
+    char       path[128];
+    int        rc;
+    int        done;            /* set by the worker when finished */
+    int        running;         /* UI side: started and not yet joined */
+    pthread_t  th;
+} ExportTask;
+
+static void* export_task_main(void* arg) {
+    ExportTask* x = (ExportTask*)arg;
+    int slot;
+    uint64_t t0 = span_begin();
+    const Snapshot* s = snap_acquire(x->st, &slot);
+    x->rc = s ? write_csv(NULL, s, x->path) : EBUSY;
+    if (s) snap_release(x->st, slot);
+    span_end(SPAN_EXPORT, t0);
+    __atomic_store_n(&x->done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+/* ---------------------------------------------------------------------------
+ * Socket server (--serve PATH): other processes on the host can query and
+ * update the open table over a Unix-domain socket, one request per line.
+ * A single thread runs an epoll loop over non-blocking connections. All
+ * complete lines that one wakeup reads are answered from one snapshot and
+ * the replies leave in one write per connection, so pipelined clients are
+ * served in batches and never touch the RowVec. SET requests are queued
+ * and the UI thread, the table's only writer, applies them once per frame.
+ *
+ *   LEN               OK <rows>
+ *   GET <i>           OK <id>,<name>,<status>
+ *   SCAN <i> <n>      OK <k>, then k CSV rows (n <= SRV_SCAN_MAX)
+ *   COUNT             OK <k>, then k "<status>,<rows>" lines
+ *   COUNT <status>    OK <rows>
+ *   SET <i> <status>  OK (visible from the next frame)
+ *                     ERR no row / ERR busy when i is out of range or
+ *                     SRV_QUEUE_MAX SETs are already waiting
+ *   otherwise         ERR <reason>
+ *
+ * Rows are addressed by storage index. itable --client PATH is a small
+ * stand-in client; with --bench N it times N pipelined GETs.
+ * --------------------------------------------------------------------------- */
+#define SRV_SCAN_MAX   10000        /* rows per SCAN */
+#define SRV_LINE_MAX   4096         /* longest request accepted */
+#define SRV_STATUSES   64           /* distinct statuses COUNT tracks */
+#define SRV_BENCH_PIPE 1000         /* requests in flight in --bench */
+#define SRV_QUEUE_MAX  65536        /* SETs waiting for the UI; more get ERR busy */
+
+typedef struct {
+    size_t row;
+    char   status[sizeof(((Row*)0)->status)];
+} SrvWrite;
+
+typedef struct {
+    int    fd;
+    char*  in;  size_t in_len,  in_cap;
+    char*  out; size_t out_len, out_cap, out_off;
+    int    closing;                 /* peer finished sending: close once flushed */
+} SrvConn;
+
+typedef struct {
+    SnapStore*      st;
+    char            path[108];
+    int             lfd, ep, stop[2];
+    pthread_t       th;
+    pthread_mutex_t mu;             /* guards the write queue */
+    SrvWrite*       q;
+    size_t          q_len, q_cap;
+    uint64_t        ops;            /* requests answered */
+    /* COUNT cache for one snapshot version (server thread only) */
+    uint64_t        count_ver;
+    int             nstatus;
+    char            status[SRV_STATUSES][sizeof(((Row*)0)->status)];
+    size_t          count[SRV_STATUSES];
+} Server;
+
+static void srv_put(SrvConn* c, const char* s, size_t n) {
+    if (c->out_len + n > c->out_cap) {
+        size_t ncap = c->out_cap ? c->out_cap * 2 : 4096;
+        while (ncap < c->out_len + n) ncap *= 2;
+        char* nb = (char*)realloc(c->out, ncap);
+        if (!nb) die_cleanup("Out of memory");
+        c->out = nb;
+        c->out_cap = ncap;
+    }
+    memcpy(c->out + c->out_len, s, n);
+    c->out_len += n;
+}
+
+static void srv_putf(SrvConn* c, const char* fmt, ...) {
+    char buf[256];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    if (n > 0) srv_put(c, buf, (size_t)n < sizeof(buf) ? (size_t)n : sizeof(buf) - 1);
+}
+
+static void srv_put_row(SrvConn* c, const Row* r) {
+    char nbuf[160], sbuf[80];
+    csv_escape(r->name, nbuf, sizeof(nbuf));
+    csv_escape(r->status, sbuf, sizeof(sbuf));
+    srv_putf(c, "%d,%s,%s\n", r->id, nbuf, sbuf);
+}
+
+/* Tally statuses of snapshot s, once per version */
+static void srv_count(Server* sv, const Snapshot* s) {
+    if (sv->count_ver == s->version) return;
+    sv->count_ver = s->version;
+    sv->nstatus = 0;
+    for (size_t c = 0; c < s->nchunks; ++c) {
+        const SnapChunk* ch = s->chunk[c];
+        int k = 0;
+        for (size_t i = 0; i < ch->n; ++i) {
+            const char* st = ch->row[i].status;
+            if (k < sv->nstatus && strcmp(sv->status[k], st) == 0) { sv->count[k]++; continue; }   /* runs are common */
+            for (k = 0; k < sv->nstatus && strcmp(sv->status[k], st) != 0; ++k) {}
+            if (k == sv->nstatus) {
+                if (k == SRV_STATUSES) { k = 0; continue; }    /* too many distinct: not counted */
+                memcpy(sv->status[k], st, sizeof(sv->status[k]));
+                sv->count[k] = 0;
+                sv->nstatus++;
+            }
+            sv->count[k]++;
+        }
+    }
+}
+
+/* Queue a SET for the UI. Returns 0, or -1 if the queue is full. */
+static int srv_queue_write(Server* sv, size_t row, const char* status) {
+    pthread_mutex_lock(&sv->mu);
+    if (sv->q_len >= SRV_QUEUE_MAX) { pthread_mutex_unlock(&sv->mu); return -1; }
+    if (sv->q_len == sv->q_cap) {
+        size_t ncap = sv->q_cap ? sv->q_cap * 2 : 256;
+        SrvWrite* nq = (SrvWrite*)realloc(sv->q, ncap * sizeof(SrvWrite));
+        if (!nq) die_cleanup("Out of memory");
+        sv->q = nq;
+        sv->q_cap = ncap;
+    }
+    SrvWrite* w = &sv->q[sv->q_len++];
+    w->row = row;
+    memset(w->status, 0, sizeof(w->status));
+    snprintf(w->status, sizeof(w->status), "%s", status);
+    pthread_mutex_unlock(&sv->mu);
+    return 0;
+}
+
+/* UI side: hand over queued writes by swapping buffers. Returns count. */
+static size_t srv_take_writes(Server* sv, SrvWrite** buf, size_t* cap) {
+    pthread_mutex_lock(&sv->mu);
+    size_t n = sv->q_len;
+    SrvWrite* mine = *buf;
+    size_t mine_cap = *cap;
+    *buf = sv->q;
+    *cap = sv->q_cap;
+    sv->q = mine;
+    sv->q_cap = mine_cap;
+    sv->q_len = 0;
+    pthread_mutex_unlock(&sv->mu);
+    return n;
+}
+
+static void srv_request(Server* sv, SrvConn* c, const Snapshot* s, char* line) {
+    char* p = line;
+    char* end;
+    while (*p == ' ') p++;
+    if (strncmp(p, "GET ", 4) == 0) {
+        size_t i = (size_t)strtoull(p + 4, &end, 10);
+        if (end == p + 4 || i >= s->len) srv_putf(c, "ERR no row %s\n", p + 4);
+        else { srv_put(c, "OK ", 3); srv_put_row(c, snap_row(s, i)); }
+    } else if (strncmp(p, "SCAN ", 5) == 0) {
+        size_t i = (size_t)strtoull(p + 5, &end, 10);
+        size_t n = (size_t)strtoull(end, NULL, 10);
+        if (n > SRV_SCAN_MAX) n = SRV_SCAN_MAX;
+        if (i > s->len) i = s->len;
+        if (n > s->len - i) n = s->len - i;
+        srv_putf(c, "OK %zu\n", n);
+        for (size_t k = 0; k < n; ++k) srv_put_row(c, snap_row(s, i + k));
+    } else if (strcmp(p, "COUNT") == 0) {
+        srv_count(sv, s);
+        srv_putf(c, "OK %d\n", sv->nstatus);
+        for (int k = 0; k < sv->nstatus; ++k) srv_putf(c, "%s,%zu\n", sv->status[k], sv->count[k]);
+    } else if (strncmp(p, "COUNT ", 6) == 0) {
+        size_t n = 0;
+        srv_count(sv, s);
+        for (int k = 0; k < sv->nstatus; ++k) if (strcmp(sv->status[k], p + 6) == 0) n = sv->count[k];
+        srv_putf(c, "OK %zu\n", n);
+    } else if (strncmp(p, "SET ", 4) == 0) {
+        size_t i = (size_t)strtoull(p + 4, &end, 10);
+        while (*end == ' ') end++;
+        if (end == p + 4 || !*end) srv_put(c, "ERR usage: SET <row> <status>\n", 30);
+        else if (i >= s->len) srv_putf(c, "ERR no row %zu\n", i);
+        else if (srv_queue_write(sv, i, end) != 0) srv_put(c, "ERR busy\n", 9);
+        else srv_put(c, "OK\n", 3);
+    } else if (strcmp(p, "LEN") == 0) {
+        srv_putf(c, "OK %zu\n", s->len);
+    } else {
+        srv_put(c, "ERR unknown request\n", 20);
+    }
+}
+
+#ifdef __linux__
+static void srv_drop(Server* sv, SrvConn* c) {
+    epoll_ctl(sv->ep, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    free(c->in);
+    free(c->out);
+    free(c);
+}
+
+/* Write pending replies; watch for EPOLLOUT while some remain.
+   Returns -1 when the connection is gone. */
+static int srv_flush(Server* sv, SrvConn* c) {
+    while (c->out_off < c->out_len) {
+        ssize_t n = send(c->fd, c->out + c->out_off, c->out_len - c->out_off, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && errno == EAGAIN) break;
+        if (n <= 0) return -1;
+        c->out_off += (size_t)n;
+    }
+    int pending = c->out_off < c->out_len;
+    if (!pending) c->out_off = c->out_len = 0;
+    if (!pending && c->closing) return -1;
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = pending ? EPOLLOUT : EPOLLIN;
+    ev.data.ptr = c;
+    epoll_ctl(sv->ep, EPOLL_CTL_MOD, c->fd, &ev);
+    return 0;
+}
+
+/* Read what is available and answer every complete line */
+static int srv_read(Server* sv, SrvConn* c, const Snapshot** s, int* slot) {
+    for (;;) {
+        if (c->in_cap - c->in_len < 4096) {
+            size_t ncap = c->in_cap ? c->in_cap * 2 : 16384;
+            char* nb = (char*)realloc(c->in, ncap);
+            if (!nb) return -1;
+            c->in = nb;
+            c->in_cap = ncap;
+        }
+        ssize_t n = read(c->fd, c->in + c->in_len, c->in_cap - c->in_len - 1);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && errno == EAGAIN) break;
+        if (n <= 0) { c->closing = 1; break; }
+        c->in_len += (size_t)n;
+        if (c->in_len > (size_t)16 << 20) break;            /* answer some before reading on */
+    }
+    size_t start = 0, done = 0;
+    for (size_t i = 0; i < c->in_len; ++i) {
+        if (c->in[i] != '\n') continue;
+        c->in[i] = '\0';
+        if (i > start && c->in[i-1] == '\r') c->in[i-1] = '\0';
+        if (!*s && !(*s = snap_acquire(sv->st, slot))) { srv_put(c, "ERR busy\n", 9); }
+        else srv_request(sv, c, *s, c->in + start);
+        start = i + 1;
+        done++;
+    }
+    memmove(c->in, c->in + start, c->in_len - start);
+    c->in_len -= start;
+    if (c->in_len > SRV_LINE_MAX) return -1;
+    __atomic_fetch_add(&sv->ops, done, __ATOMIC_RELAXED);
+    return 0;
+}
+
+static void* srv_main(void* arg) {
+    Server* sv = (Server*)arg;
+    struct epoll_event ev[64];
+    for (;;) {
+        int n = epoll_wait(sv->ep, ev, 64, -1);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) break;
+        const Snapshot* s = NULL;           /* one version for the whole wakeup */
+        int slot = 0, quit = 0;
+        for (int k = 0; k < n; ++k) {
+            if (ev[k].data.ptr == &sv->stop[0]) { quit = 1; continue; }
+            if (ev[k].data.ptr == &sv->lfd) {
+                int fd;
+                while ((fd = accept(sv->lfd, NULL, NULL)) >= 0) {
+                    SrvConn* c = (SrvConn*)calloc(1, sizeof(SrvConn));
+                    if (!c) { close(fd); continue; }
+                    c->fd = fd;
+                    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+                    struct epoll_event e;
+                    memset(&e, 0, sizeof(e));
+                    e.events = EPOLLIN;
+                    e.data.ptr = c;
+                    if (epoll_ctl(sv->ep, EPOLL_CTL_ADD, fd, &e) != 0) { close(fd); free(c); }
+                }
+                continue;
+            }
+            SrvConn* c = (SrvConn*)ev[k].data.ptr;
+            if ((ev[k].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) && !c->closing && srv_read(sv, c, &s, &slot) != 0) { srv_drop(sv, c); continue; }
+            if (srv_flush(sv, c) != 0) srv_drop(sv, c);
+        }
+        if (s) snap_release(sv->st, slot);
+        if (quit) break;
+    }
+    return NULL;
+}
+#endif
+
+/* Listen on path and start the server thread. Returns 0 or errno. */
+static int srv_start(Server* sv, const char* path, SnapStore* st) {
+#ifdef __linux__
+    memset(sv, 0, sizeof(*sv));
+    sv->st = st;
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) return ENAMETOOLONG;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+    snprintf(sv->path, sizeof(sv->path), "%s", path);
+    struct stat sb;
+    if (stat(path, &sb) == 0 && S_ISSOCK(sb.st_mode)) {   /* another instance, or a stale socket */
+        int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (probe < 0) return errno;
+        int live = connect(probe, (struct sockaddr*)&addr, sizeof(addr)) == 0;
+        int refused = !live && errno == ECONNREFUSED;
+        close(probe);
+        if (live) return EADDRINUSE;
+        if (refused) unlink(path);                          /* nobody listening: left by an earlier run */
+    }
+
+    sv->lfd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sv->lfd < 0) return errno;
+    if (bind(sv->lfd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(sv->lfd, 64) != 0) {
+        int e = errno; close(sv->lfd); return e;
+    }
+    fcntl(sv->lfd, F_SETFL, fcntl(sv->lfd, F_GETFL) | O_NONBLOCK);
+    sv->ep = epoll_create1(0);
+    if (sv->ep < 0) { int e = errno; close(sv->lfd); unlink(path); return e; }
+    if (pipe(sv->stop) != 0) { int e = errno; close(sv->ep); close(sv->lfd); unlink(path); return e; }
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = &sv->lfd;
+    epoll_ctl(sv->ep, EPOLL_CTL_ADD, sv->lfd, &ev);
+    ev.data.ptr = &sv->stop[0];
+    epoll_ctl(sv->ep, EPOLL_CTL_ADD, sv->stop[0], &ev);
+    pthread_mutex_init(&sv->mu, NULL);
+    int rc = pthread_create(&sv->th, NULL, srv_main, sv);
+    if (rc != 0) {
+        pthread_mutex_destroy(&sv->mu);
+        close(sv->stop[0]); close(sv->stop[1]);
+        close(sv->ep); close(sv->lfd); unlink(path);
+        return rc;
+    }
+    return 0;
+#else
+    (void)sv; (void)path; (void)st;
+    return ENOSYS;
+#endif
+}
+
+/* Stop the thread and remove the socket. Open connections are dropped. */
+static void srv_stop(Server* sv) {
+#ifdef __linux__
+    if (write(sv->stop[1], "x", 1) != 1) { /* the thread is gone already */ }
+    pthread_join(sv->th, NULL);
+    close(sv->stop[0]);
+    close(sv->stop[1]);
+    close(sv->lfd);
+    close(sv->ep);                       /* connections are left to exit() */
+    unlink(sv->path);
+    pthread_mutex_destroy(&sv->mu);
+    free(sv->q);
+#else
+    (void)sv;
+#endif
+}
+
+/* Stand-in client: send stdin to the server and print the replies, or
+   with bench > 0 time that many pipelined GETs. Returns an exit status. */
+static int client_main(const char* path, size_t bench) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) { perror(path); return 1; }
+    char buf[65536];
+    if (!bench) {
+        ssize_t n;
+        while ((n = read(0, buf, sizeof(buf))) > 0)
+            for (ssize_t off = 0; off < n; ) {
+                ssize_t w = write(fd, buf + off, (size_t)(n - off));
+                if (w <= 0) { perror("write"); return 1; }
+                off += w;
+            }
+        shutdown(fd, SHUT_WR);
+        while ((n = read(fd, buf, sizeof(buf))) > 0)
+            if (fwrite(buf, 1, (size_t)n, stdout) != (size_t)n) return 1;
+        close(fd);
+        return 0;
+    }
+    /* rows to ask for: whatever LEN says */
+    size_t rows = 0;
+    if (write(fd, "LEN\n", 4) != 4) { perror("write"); return 1; }
+    ssize_t n = read(fd, buf, sizeof(buf) - 1);
+    if (n > 0) { buf[n] = '\0'; rows = (size_t)strtoull(buf + 3, NULL, 10); }
+    if (rows == 0) { fprintf(stderr, "%s: empty table\n", path); return 1; }
+
+    uint64_t t0 = prof_now_ns();
+    size_t sent = 0, answered = 0;
+    char req[SRV_BENCH_PIPE * 24];
+    while (answered < bench) {
+        size_t len = 0;
+        for (int k = 0; k < SRV_BENCH_PIPE && sent < bench; ++k, ++sent)
+            len += (size_t)sprintf(req + len, "GET %zu\n", (size_t)(splitmix64(sent) % rows));
+        for (size_t off = 0; off < len; ) {
+            ssize_t w = write(fd, req + off, len - off);
+            if (w <= 0) { perror("write"); return 1; }
+            off += (size_t)w;
+        }
+        while (answered < sent) {                 /* one reply line per GET */
+            n = read(fd, buf, sizeof(buf));
+            if (n <= 0) { fprintf(stderr, "%s: connection closed\n", path); return 1; }
+            for (ssize_t i = 0; i < n; ++i) answered += buf[i] == '\n';
+        }
+    }
+    double s = (double)(prof_now_ns() - t0) / 1e9;
+    printf("%zu GETs in %.3f s: %.0f ops/s\n", bench, s, (double)bench / s);
+    close(fd);
+    return 0;
+}
+
+/* ---------------------------------------------------------------------------
+ * Shared-memory publishing (--shm NAME): the table is mirrored into a
+ * POSIX shared-memory segment in the columnar layout of itable_shm.h, so
+ * processes on the same host can read rows with no syscall and no copy.
+ * The mirror is fed from snapshots. Only chunks whose version changed
+ * since the last sync are copied, inside one seqlock write section.
+ * --------------------------------------------------------------------------- */
+/* shm_pub_sync copies whole Row fields into the columns: widths must agree */
+typedef char shm_name_width_matches_row[sizeof(((Row*)0)->name) == ITSHM_NAME ? 1 : -1];
+typedef char shm_status_width_matches_row[sizeof(((Row*)0)->status) == ITSHM_STATUS ? 1 : -1];
+
+typedef struct {
+    char           name[64];
+    int            fd;
+    unsigned char* base;
+    size_t         size;
+    uint64_t*      chunk_gen;      /* per chunk: version of the copy in the segment */
+    size_t         nchunk_gen;
+    uint64_t       version;        /* snapshot version last synced */
+} ShmPub;
+
+static ItShmHeader* shm_hdr(ShmPub* p) { return (ItShmHeader*)p->base; }
+
+/* Grow the segment to hold cap rows and move the columns; everything is
+   copied again afterwards. Called inside a write section. */
+static int shm_pub_layout(ShmPub* p, uint64_t cap) {
+    uint64_t id = ITSHM_HEADER;
+    uint64_t name = id + ((cap * sizeof(int32_t) + 63) & ~(uint64_t)63);
+    uint64_t status = name + cap * ITSHM_NAME;
+    uint64_t size = (status + cap * ITSHM_STATUS + 4095) & ~(uint64_t)4095;
+    if (ftruncate(p->fd, (off_t)size) != 0) return errno;
+    void* m = mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, p->fd, 0);
+    if (m == MAP_FAILED) return errno;
+    munmap(p->base, p->size);
+    p->base = (unsigned char*)m;
+    p->size = (size_t)size;
+    ItShmHeader* h = shm_hdr(p);
+    h->size = size;
+    h->capacity = cap;
+    h->id_off = id;
+    h->name_off = name;
+    h->status_off = status;
+    h->generation++;
+    if (p->chunk_gen) memset(p->chunk_gen, 0, p->nchunk_gen * sizeof(uint64_t));
+    return 0;
+}
+
+/* State of an existing segment: 1 if its writer is still running, 0 if
+   it was left behind (writer gone, or never finished creating it), -1 if
+   it is not an itable segment. */
+static int shm_pub_probe(const char* name) {
+    struct stat st;
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) return 0;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < ITSHM_HEADER) { close(fd); return 0; }
+    void* m = mmap(NULL, ITSHM_HEADER, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (m == MAP_FAILED) return 0;
+    const ItShmHeader* h = (const ItShmHeader*)m;
+    int state = -1;
+    if (memcmp(h->magic, ITSHM_MAGIC, sizeof(ITSHM_MAGIC)) == 0) {
+        pid_t pid = (pid_t)__atomic_load_n(&h->writer_pid, __ATOMIC_RELAXED);
+        state = pid > 0 && (kill(pid, 0) == 0 || errno == EPERM);
+    }
+    munmap(m, ITSHM_HEADER);
+    return state;
+}
+
+static int shm_pub_open(ShmPub* p, const char* name) {
+    memset(p, 0, sizeof(*p));
+    snprintf(p->name, sizeof(p->name), "%s", name);
+    p->fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (p->fd < 0 && errno == EEXIST) {          /* another itable, or a stale segment */
+        int state = shm_pub_probe(name);
+        if (state != 0) return state > 0 ? EBUSY : EEXIST;
+        shm_unlink(name);
+        p->fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    }
+    if (p->fd < 0) return errno;
+    if (ftruncate(p->fd, ITSHM_HEADER) != 0) { int e = errno; close(p->fd); shm_unlink(name); return e; }
+    void* m = mmap(NULL, ITSHM_HEADER, PROT_READ | PROT_WRITE, MAP_SHARED, p->fd, 0);
+    if (m == MAP_FAILED) { int e = errno; close(p->fd); shm_unlink(name); return e; }
+    p->base = (unsigned char*)m;
+    p->size = ITSHM_HEADER;
+    ItShmHeader* h = shm_hdr(p);
+    memcpy(h->magic, ITSHM_MAGIC, sizeof(ITSHM_MAGIC));
+    h->size = ITSHM_HEADER;
+    h->id_off = h->name_off = h->status_off = ITSHM_HEADER;
+    h->writer_pid = (uint64_t)getpid();
+    return 0;
+}
+
+/* Bring the segment up to snapshot s. Returns 0 or errno. */
+static int shm_pub_sync(ShmPub* p, const Snapshot* s) {
+    if (!s || s->version == p->version) return 0;
+    ItShmHeader* h = shm_hdr(p);
+    uint64_t seq = h->seq;
+    int rc = 0;
+    __atomic_store_n(&h->seq, seq + 1, __ATOMIC_RELAXED);       /* readers: retry */
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    if (s->len > h->capacity) {
+        uint64_t cap = s->len + s->len / 2 > 4096 ? s->len + s->len / 2 : 4096;
+        if ((rc = shm_pub_layout(p, cap)) != 0) goto out;
+        h = shm_hdr(p);
+    }
+    if (s->nchunks > p->nchunk_gen) {
+        uint64_t* ng = (uint64_t*)realloc(p->chunk_gen, s->nchunks * sizeof(uint64_t));
+        if (!ng) { rc = ENOMEM; goto out; }
+        memset(ng + p->nchunk_gen, 0, (s->nchunks - p->nchunk_gen) * sizeof(uint64_t));
+        p->chunk_gen = ng;
+        p->nchunk_gen = s->nchunks;
+    }
+    int32_t* ids = (int32_t*)(p->base + h->id_off);
+    char* names = (char*)p->base + h->name_off;
+    char* statuses = (char*)p->base + h->status_off;
+    for (size_t c = 0; c < s->nchunks; ++c) {
+        const SnapChunk* ch = s->chunk[c];
+        if (p->chunk_gen[c] == ch->gen) continue;
+        size_t a = c * SNAP_CHUNK;
+        for (size_t i = 0; i < ch->n; ++i) {
+            ids[a + i] = ch->row[i].id;
+            memcpy(names + (a + i) * ITSHM_NAME, ch->row[i].name, ITSHM_NAME);
+            memcpy(statuses + (a + i) * ITSHM_STATUS, ch->row[i].status, ITSHM_STATUS);
+        }
+        p->chunk_gen[c] = ch->gen;
+    }
+    h->rows = s->len;
+    h->version = s->version;
+    p->version = s->version;
+out:
+    __atomic_store_n(&h->seq, seq + 2, __ATOMIC_RELEASE);
+    return rc;
+}
+
+static void shm_pub_close(ShmPub* p) {
+    if (p->base) __atomic_store_n(&shm_hdr(p)->writer_pid, 0, __ATOMIC_RELAXED);
+    if (p->base) munmap(p->base, p->size);
+    if (p->fd >= 0) close(p->fd);
+    shm_unlink(p->name);
+    free(p->chunk_gen);
+}
+
+/* --shm-read NAME: print row and status counts read straight from the
+   segment, or with bench > 0 time that many random row reads. */
+static int shm_read_main(const char* name, size_t bench) {
+    ItShmReader r;
+    if (itshm_open(&r, name) != 0) { fprintf(stderr, "%s: not an itable segment\n", name); return 1; }
+    if (!bench) {
+        char status[SRV_STATUSES][ITSHM_STATUS];
+        size_t count[SRV_STATUSES], rows = 0;
+        int nstatus = 0;
+        do {                                       /* one consistent pass, no copies */
+            uint64_t seq = itshm_read_begin(&r);
+            if (itshm_header(&r)->generation != r.generation) {
+                if (itshm_remap(&r) != 0) break;
+                continue;
+            }
+            rows = itshm_header(&r)->rows;
+            nstatus = 0;
+            for (size_t i = 0; i < rows && i < r.capacity; ++i) {
+                const char* st = itshm_status(&r, i);
+                int k = 0;
+                while (k < nstatus && strncmp(status[k], st, ITSHM_STATUS) != 0) k++;
+                if (k == nstatus) {
+                    if (k == SRV_STATUSES) continue;
+                    memcpy(status[k], st, ITSHM_STATUS);
+                    status[k][ITSHM_STATUS - 1] = '\0';
+                    count[nstatus++] = 0;
+                }
+                count[k]++;
+            }
+            if (!itshm_read_retry(&r, seq)) break;
+        } while (1);
+        printf("rows: %zu\n", rows);
+        for (int k = 0; k < nstatus; ++k) printf("%s,%zu\n", status[k], count[k]);
+        itshm_close(&r);
+        return 0;
+    }
+    uint64_t rows = itshm_rows(&r);
+    if (rows == 0) { fprintf(stderr, "%s: empty table\n", name); return 1; }
+    uint64_t t0 = prof_now_ns(), sum = 0;
+    ItShmRow row;
+    for (size_t k = 0; k < bench; ++k)
+        if (itshm_read_row(&r, splitmix64(k) % rows, &row) == 0) sum += (uint64_t)row.id;
+    double s = (double)(prof_now_ns() - t0) / 1e9;
+    printf("%zu row reads in %.3f s: %.0f ops/s (id sum %llu)\n", bench, s, (double)bench / s, (unsigned long long)sum);
+    itshm_close(&r);
+    return 0;
+}
+
+/* ---------------------------------------------------------------------------
+ * Follow mode (like tail -f): keep reading a growing CSV file, or a pipe
+ * on stdin, and append arrivals to the RowVec. The source is non-blocking
+ * and polled once per frame; on Linux an epoll set holds the pipe, or an
+ * inotify watch on the file, so an idle frame costs one epoll_wait and no
+ * read. At most FOLLOW_BUDGET bytes are parsed per frame so that a fast
+ * feed cannot starve keyboard handling; the rest waits for the next frame.
+ * --------------------------------------------------------------------------- */
+#define FOLLOW_BUDGET   (4u << 20)    /* bytes parsed per frame */
+#define FOLLOW_FRAME_MS 50            /* getch timeout while following */
+
+typedef struct {
+    int       fd;          /* O_NONBLOCK source */
+    int       is_file;
+    off_t     off;         /* file: bytes consumed so far */
+    int       ep, ino;     /* epoll set and inotify fd, -1 when unused */
+    int       backlog;     /* last poll stopped at the budget */
+    int       eof;         /* pipe closed by the writer */
+    CsvParser cp;
+    char*     buf;
+} Follow;
+
+/* Start following path ("-" = stdin). For stdin the keyboard moves to
+   /dev/tty so curses can still read it. Returns 0 or errno. */
+static int follow_open(Follow* f, const char* path, RowVec* v) {
+    memset(f, 0, sizeof(*f));
+    f->ep = f->ino = -1;
+    f->cp.v = v;
+    f->buf = (char*)malloc(IO_CHUNK);
+    if (!f->buf) return ENOMEM;
+    if (strcmp(path, "-") == 0) {
+        int tty = open("/dev/tty", O_RDWR);
+        if (tty < 0 || (f->fd = dup(0)) < 0 || dup2(tty, 0) < 0) {
+            int e = errno;
+            if (tty >= 0) close(tty);
+            return e;
+        }
+        close(tty);
+    } else {
+        f->fd = open(path, O_RDONLY);
+        if (f->fd < 0) return errno;
+        f->is_file = 1;
+    }
+    fcntl(f->fd, F_SETFL, fcntl(f->fd, F_GETFL) | O_NONBLOCK);
+#ifdef __linux__
+    f->ep = epoll_create1(0);
+    if (f->ep >= 0) {
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        int watch = f->fd;
+        if (f->is_file) {
+            f->ino = inotify_init1(IN_NONBLOCK);
+            if (f->ino >= 0 && inotify_add_watch(f->ino, path, IN_MODIFY) < 0) { close(f->ino); f->ino = -1; }
+            watch = f->ino;
+        }
+        if (watch < 0 || epoll_ctl(f->ep, EPOLL_CTL_ADD, watch, &ev) != 0) { close(f->ep); f->ep = -1; }
+    }
+#endif
+    f->backlog = 1;                   /* read what is already there */
+    return 0;
+}
+
+/* Parse up to budget bytes of new input into the table. Returns the
+   number of rows appended. */
+static size_t follow_poll(Follow* f, size_t budget) {
+    size_t before = f->cp.v->len, got = 0;
+    if (f->eof) return 0;
+#ifdef __linux__
+    if (f->ep >= 0 && !f->backlog) {
+        struct epoll_event ev;
+        if (epoll_wait(f->ep, &ev, 1, 0) <= 0) return 0;
+        if (f->ino >= 0) {
+            char evbuf[4096];
+            while (read(f->ino, evbuf, sizeof(evbuf)) > 0) { }   /* only "it changed" matters */
+        }
+    }
+#endif
+    if (f->is_file) {                 /* truncated (log rotation): start over */
+        struct stat st;
+        if (fstat(f->fd, &st) == 0 && st.st_size < f->off) {
+            lseek(f->fd, 0, SEEK_SET);
+            f->off = 0;
+            f->cp.carry_len = 0;
+            f->cp.in_quote = 0;
+        }
+    }
+    f->backlog = 0;
+    while (got < budget) {
+        ssize_t n = read(f->fd, f->buf, IO_CHUNK);
+        if (n < 0 && errno == EINTR) continue;
+        if (n == 0 && !f->is_file) f->eof = 1;
+        if (n <= 0) break;
+        if (csv_feed(&f->cp, f->buf, (size_t)n) != 0) break;
+        f->off += n;
+        got += (size_t)n;
+    }
+    if (got >= budget) f->backlog = 1;
+    if (f->eof && f->cp.carry_len) {  /* last record had no newline */
+        csv_emit(&f->cp, f->cp.carry, f->cp.carry_len);
+        f->cp.carry_len = 0;
+    }
+    return f->cp.v->len - before;
+}
+
+static void follow_close(Follow* f) {
+    if (f->ino >= 0) close(f->ino);
+    if (f->ep >= 0) close(f->ep);
+    if (f->fd >= 0) close(f->fd);
+    free(f->cp.carry);
+    free(f->buf);
+}
+
+/* ---------------------------------------------------------------------------
+ * Row sources: tables that are not (or not fully) resident in memory.
+ * A source only knows how to count, read a row range and overwrite a row;
+ * the PageCache below keeps a bounded LRU set of pages of it in memory.
+ * --------------------------------------------------------------------------- */
+
+typedef struct RowSource RowSource;
+struct RowSource {
+    const char* name;
+    size_t (*count)(RowSource* s);
+    int    (*read)(RowSource* s, size_t a, size_t b, Row* out);   /* rows [a,b); 0 or errno */
+    int    (*write)(RowSource* s, size_t idx, const Row* r);     /* NULL if read-only */
+    void   (*close)(RowSource* s);
+};
+
+/* .itb file: 16-byte header ("ITB1", u32 sizeof(Row), u64 rows) followed by
+   fixed-size native Row records, so row i lives at a computable offset. */
+#define ITB_MAGIC "ITB1"
+#define ITB_HDR   16
+
+typedef struct {
+    RowSource base;
+    int       fd;
+    size_t    len;
+} FileSource;
+
+static size_t file_src_count(RowSource* s) { return ((FileSource*)s)->len; }
+
+static int file_src_read(RowSource* s, size_t a, size_t b, Row* out) {
+    FileSource* fs = (FileSource*)s;
+    size_t want = (b - a) * sizeof(Row), got = 0;
+    off_t off = (off_t)(ITB_HDR + a * sizeof(Row));
+    while (got < want) {
+        ssize_t n = pread(fs->fd, (char*)out + got, want - got, off + (off_t)got);
+        if (n < 0) { if (errno == EINTR) continue; return errno; }
+        if (n == 0) return EIO;
+        got += (size_t)n;
+    }
+    return 0;
+}
+
+static int file_src_write(RowSource* s, size_t idx, const Row* r) {
+    FileSource* fs = (FileSource*)s;
+    off_t off = (off_t)(ITB_HDR + idx * sizeof(Row));
+    ssize_t n = pwrite(fs->fd, r, sizeof(Row), off);
+    return (n == (ssize_t)sizeof(Row)) ? 0 : (n < 0) ? errno : ENOSPC;
+}
+
+static void file_src_close(RowSource* s) {
+    close(((FileSource*)s)->fd);
+    free(s);
+}
+
+static RowSource* file_source_open(const char* path) {
+    int writable = 1;
+    int fd = open(path, O_RDWR);
+    if (fd < 0) { writable = 0; fd = open(path, O_RDONLY); }
+    if (fd < 0) return NULL;
+
+    unsigned char hdr[ITB_HDR];
+    uint32_t rowsz; uint64_t rows;
+    if (pread(fd, hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr) || memcmp(hdr, ITB_MAGIC, 4) != 0) {
+        close(fd); errno = EINVAL; return NULL;
+    }
+    memcpy(&rowsz, hdr + 4, 4);
+    memcpy(&rows, hdr + 8, 8);
+    if (rowsz != sizeof(Row)) { close(fd); errno = EINVAL; return NULL; }
+    /* The header must not claim more rows than the file holds, or reads
+       past the end would come back short. Divide rather than multiply so
+       a huge count cannot wrap. */
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < ITB_HDR ||
+        rows > ((uint64_t)st.st_size - ITB_HDR) / rowsz) {
+        close(fd); errno = EINVAL; return NULL;
+    }
+
+    FileSource* fs = (FileSource*)calloc(1, sizeof(*fs));
+    if (!fs) { close(fd); return NULL; }
+    fs->base.name  = path;
+    fs->base.count = file_src_count;
+    fs->base.read  = file_src_read;
+    fs->base.write = writable ? file_src_write : NULL;
+    fs->base.close = file_src_close;
+    fs->fd  = fd;
+    fs->len = (size_t)rows;
+    return &fs->base;
+}
+
+/* Save an in-memory table as .itb. Returns 0 or errno. */
+static int write_itb(const RowVec* v, const char* path) {
+    FILE* f = fopen(path, "wb");
+    if (!f) return errno;
+    unsigned char hdr[ITB_HDR];
+    uint32_t rowsz = (uint32_t)sizeof(Row);
+    uint64_t rows = (uint64_t)v->len;
+    memcpy(hdr, ITB_MAGIC, 4);
+    memcpy(hdr + 4, &rowsz, 4);
+    memcpy(hdr + 8, &rows, 8);
+    int ok = fwrite(hdr, 1, sizeof(hdr), f) == sizeof(hdr) &&
+             fwrite(v->data, sizeof(Row), v->len, f) == v->len;
+    int err = ok ? 0 : errno;
+    if (fclose(f) != 0 && !err) err = errno;
+    return err;
+}
+
+/* gen:N — rows synthesized on demand by gen_spec_row, so arbitrarily
+   large tables can be browsed without any storage at all. The --name-len,
+   --status-mix, --ids and --seed options apply as they do to --gen. */
+typedef struct {
+    RowSource base;
+    GenSpec   spec;
+} GenSource;
+
+static size_t gen_src_count(RowSource* s) { return ((GenSource*)s)->spec.rows; }
+
+static int gen_src_read(RowSource* s, size_t a, size_t b, Row* out) {
+    const GenSpec* g = &((GenSource*)s)->spec;
+    for (size_t i = a; i < b; ++i) gen_spec_row(g, i, &out[i - a]);
+    return 0;
+}
+
+static void gen_src_close(RowSource* s) { free(s); }
+
+static RowSource* gen_source_open(const GenSpec* g) {
+    GenSource* gs = (GenSource*)calloc(1, sizeof(*gs));
+    if (!gs) return NULL;
+    gs->base.name  = "generated";
+    gs->base.count = gen_src_count;
+    gs->base.read  = gen_src_read;
+    gs->base.write = NULL;
+    gs->base.close = gen_src_close;
+    gs->spec = *g;
+    return &gs->base;
+}
+
+/* ---------------------------------------------------------------------------
+ * Compressed tables (.itz)
+ * Rows are stored in independent blocks of ITZ_BLOCK_ROWS rows. Each block
+ * is split into columns (ids, names, statuses; string padding zeroed) and
+ * compressed with a built-in LZ4-format block codec. Blocks are compressed
+ * and decompressed in parallel, and a block index at the end of the file
+ * lets the viewer decompress only the blocks around the viewport.
+ *
+ * Layout (native endianness):
+ *   header   "ITZ1" u32 sizeof(Row) u64 rows u32 block_rows u32 nblocks u64 index_off
+ *   blocks   compressed bytes, back to back
+ *   index    nblocks x { u64 offset, u32 csize, u32 rows }
+ * --------------------------------------------------------------------------- */
+#define ITZ_MAGIC      "ITZ1"
+#define ITZ_HDR        32
+#define ITZ_BLOCK_ROWS 4096
+#define LZ_HASH_BITS   16
+
+typedef struct {
+    uint64_t off;
+    uint32_t csize;
+    uint32_t rows;
+} ItzIndex;
+
+static size_t lz_bound(size_t n) { return n + n / 255 + 16; }
+
+static uint32_t lz_read32(const unsigned char* p) { uint32_t v; memcpy(&v, p, 4); return v; }
+static unsigned lz_hash(uint32_t v) { return (v * 2654435761u) >> (32 - LZ_HASH_BITS); }
+
+static unsigned char* lz_put_len(unsigned char* op, size_t len) {
+    while (len >= 255) { *op++ = 255; len -= 255; }
+    *op++ = (unsigned char)len;
+    return op;
+}
+
+static unsigned char* lz_sequence(unsigned char* op, const unsigned char* lit, size_t litlen,
+                                  size_t offset, size_t mlen) {
+    unsigned char* token = op++;
+    *token = (unsigned char)((litlen < 15 ? litlen : 15) << 4);
+    if (litlen >= 15) op = lz_put_len(op, litlen - 15);
+    memcpy(op, lit, litlen);
+    op += litlen;
+    if (mlen == 0) return op;                   /* final literal-only sequence */
+    *op++ = (unsigned char)(offset & 255);
+    *op++ = (unsigned char)(offset >> 8);
+    mlen -= 4;
+    *token |= (unsigned char)(mlen < 15 ? mlen : 15);
+    if (mlen >= 15) op = lz_put_len(op, mlen - 15);
+    return op;
+}
+
+/* Greedy LZ4 block compression; dst needs lz_bound(n) bytes and table
+   (1 << LZ_HASH_BITS) entries. Returns the compressed size. */
+static size_t lz_compress(const unsigned char* src, size_t n, unsigned char* dst, uint32_t* table) {
+    const unsigned char* ip = src;
+    const unsigned char* anchor = src;
+    const unsigned char* end = src + n;
+    unsigned char* op = dst;
+    memset(table, 0, sizeof(uint32_t) << LZ_HASH_BITS);
+
+    if (n >= 13) {
+        const unsigned char* mflimit = end - 12;    /* last match starts before here */
+        const unsigned char* matchlimit = end - 5;  /* and ends before the last 5 bytes */
+        while (ip < mflimit) {
+            uint32_t seq = lz_read32(ip);
+            unsigned h = lz_hash(seq);
+            uint32_t cand = table[h];
+            table[h] = (uint32_t)(ip - src) + 1;
+            const unsigned char* ref = src + cand - 1;
+            if (!cand || ip - ref > 65535 || lz_read32(ref) != seq) { ip++; continue; }
+
+            while (ip > anchor && ref > src && ip[-1] == ref[-1]) { ip--; ref--; }
+            size_t ml = 4;
+            while (ip + ml < matchlimit && ip[ml] == ref[ml]) ml++;
+
+            op = lz_sequence(op, anchor, (size_t)(ip - anchor), (size_t)(ip - ref), ml);
+            ip += ml;
+            anchor = ip;
+            if (ip - 2 > src && ip < mflimit) table[lz_hash(lz_read32(ip - 2))] = (uint32_t)(ip - 2 - src) + 1;
+        }
+    }
+    op = lz_sequence(op, anchor, (size_t)(end - anchor), 0, 0);
+    return (size_t)(op - dst);
+}
+
+/* Bounds-checked LZ4 block decompression. Returns decoded size or -1. */
+static long lz_decompress(const unsigned char* src, size_t n, unsigned char* dst, size_t cap) {
+    const unsigned char* ip = src;
+    const unsigned char* iend = src + n;
+    unsigned char* op = dst;
+    unsigned char* oend = dst + cap;
+    while (ip < iend) {
+        unsigned token = *ip++;
+        size_t lit = token >> 4;
+        if (lit == 15) {
+            unsigned b;
+            do { if (ip >= iend) return -1; b = *ip++; lit += b; } while (b == 255);
+        }
+        if ((size_t)(iend - ip) < lit || (size_t)(oend - op) < lit) return -1;
+        memcpy(op, ip, lit);
+        op += lit; ip += lit;
+        if (ip == iend) break;                   /* last sequence has no match */
+        if (iend - ip < 2) return -1;
+        size_t off = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        if (off == 0 || off > (size_t)(op - dst)) return -1;
+        size_t ml = token & 15;
+        if (ml == 15) {
+            unsigned b;
+            do { if (ip >= iend) return -1; b = *ip++; ml += b; } while (b == 255);
+        }
+        ml += 4;
+        if ((size_t)(oend - op) < ml) return -1;
+        const unsigned char* m = op - off;
+        if (off >= ml) memcpy(op, m, ml);
+        else for (size_t i = 0; i < ml; ++i) op[i] = m[i];   /* overlapping run */
+        op += ml;
+    }
+    return (long)(op - dst);
+}
+
+/* Row block <-> column-split bytes (ids, then names, then statuses) */
+static void itz_pack(const Row* rows, size_t n, unsigned char* out) {
+    unsigned char* ids = out;
+    unsigned char* names = ids + n * sizeof(int);
+    unsigned char* stats = names + n * sizeof(rows->name);
+    for (size_t i = 0; i < n; ++i) {
+        const Row* r = &rows[i];
+        size_t nl = strnlen(r->name, sizeof(r->name));
+        size_t sl = strnlen(r->status, sizeof(r->status));
+        memcpy(ids + i * sizeof(int), &r->id, sizeof(int));
+        memcpy(names + i * sizeof(r->name), r->name, nl);
+        memset(names + i * sizeof(r->name) + nl, 0, sizeof(r->name) - nl);
+        memcpy(stats + i * sizeof(r->status), r->status, sl);
+        memset(stats + i * sizeof(r->status) + sl, 0, sizeof(r->status) - sl);
+    }
+}
+
+static void itz_unpack(const unsigned char* in, size_t n, Row* rows) {
+    const unsigned char* ids = in;
+    const unsigned char* names = ids + n * sizeof(int);
+    const unsigned char* stats = names + n * sizeof(rows->name);
+    for (size_t i = 0; i < n; ++i) {
+        Row* r = &rows[i];
+        memcpy(&r->id, ids + i * sizeof(int), sizeof(int));
+        memcpy(r->name, names + i * sizeof(r->name), sizeof(r->name));
+        memcpy(r->status, stats + i * sizeof(r->status), sizeof(r->status));
+        r->name[sizeof(r->name)-1] = '\0';
+        r->status[sizeof(r->status)-1] = '\0';
+    }
+}
+
+/* Decode one block read from fd into rows. Returns 0 or errno. */
+static int itz_read_block(int fd, const ItzIndex* ix, Row* rows) {
+    size_t raw = (size_t)ix->rows * sizeof(Row);
+    unsigned char* cbuf = (unsigned char*)malloc(ix->csize);
+    unsigned char* ubuf = (unsigned char*)malloc(raw);
+    int err = 0;
+    if (!cbuf || !ubuf) err = ENOMEM;
+    else if (pread(fd, cbuf, ix->csize, (off_t)ix->off) != (ssize_t)ix->csize) err = EIO;
+    else if (lz_decompress(cbuf, ix->csize, ubuf, raw) != (long)raw) err = EILSEQ;
+    else itz_unpack(ubuf, ix->rows, rows);
+    free(cbuf);
+    free(ubuf);
+    return err;
+}
+
+typedef struct {
+    int       fd;
+    uint64_t  rows;
+    uint32_t  nblocks;
+    ItzIndex* index;
+} ItzFile;
+
+/* Blocks must tile [0, rows) exactly and lie between the header and the
+   index, so a corrupt file cannot make a decode overrun its rows. */
+static int itz_check_index(const ItzFile* z, uint64_t index_off) {
+    for (uint32_t b = 0; b < z->nblocks; ++b) {
+        const ItzIndex* ix = &z->index[b];
+        uint64_t want = (b + 1 < z->nblocks) ? ITZ_BLOCK_ROWS : z->rows - (uint64_t)b * ITZ_BLOCK_ROWS;
+        if (ix->rows != want || ix->off < ITZ_HDR || ix->off > index_off || ix->csize > index_off - ix->off)
+            return EINVAL;
+    }
+    return 0;
+}
+
+static int itz_open(ItzFile* z, const char* path) {
+    unsigned char hdr[ITZ_HDR];
+    uint32_t rowsz, block_rows;
+    uint64_t index_off;
+    struct stat st;
+    memset(z, 0, sizeof(*z));
+    z->fd = open(path, O_RDONLY);
+    if (z->fd < 0) return errno;
+    if (fstat(z->fd, &st) != 0 || pread(z->fd, hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr) ||
+        memcmp(hdr, ITZ_MAGIC, 4) != 0) {
+        close(z->fd); return EINVAL;
+    }
+    memcpy(&rowsz, hdr + 4, 4);
+    memcpy(&z->rows, hdr + 8, 8);
+    memcpy(&block_rows, hdr + 16, 4);
+    memcpy(&z->nblocks, hdr + 20, 4);
+    memcpy(&index_off, hdr + 24, 8);
+    if (rowsz != sizeof(Row) || block_rows != ITZ_BLOCK_ROWS ||
+        z->rows > (uint64_t)SIZE_MAX / sizeof(Row) ||
+        z->nblocks != (z->rows + ITZ_BLOCK_ROWS - 1) / ITZ_BLOCK_ROWS) {
+        close(z->fd); return EINVAL;
+    }
+    size_t isz = (size_t)z->nblocks * sizeof(ItzIndex);
+    if (index_off < ITZ_HDR || index_off > (uint64_t)st.st_size || isz > (uint64_t)st.st_size - index_off) {
+        close(z->fd); return EINVAL;
+    }
+    z->index = (ItzIndex*)malloc(isz ? isz : 1);
+    if (!z->index) { close(z->fd); return ENOMEM; }
+    int err = 0;
+    if (isz && pread(z->fd, z->index, isz, (off_t)index_off) != (ssize_t)isz) err = EIO;
+    else err = itz_check_index(z, index_off);
+    if (err) { free(z->index); close(z->fd); return err; }
+    return 0;
+}
+
+static void itz_close(ItzFile* z) { free(z->index); close(z->fd); }
+
+/* Parallel save: blocks are compressed in batches on all cores and written
+   in order. Returns 0 or errno. */
+typedef struct {
+    const RowVec*   v;
+    size_t          first;      /* first block of the batch */
+    unsigned char** out;
+    size_t*         csize;
+} ItzSaveJob;
+
+static void itz_compress_one(void* ctx, size_t i) {
+    ItzSaveJob* j = (ItzSaveJob*)ctx;
+    size_t b = j->first + i;
+    size_t a = b * ITZ_BLOCK_ROWS;
+    size_t n = (j->v->len - a < ITZ_BLOCK_ROWS) ? j->v->len - a : ITZ_BLOCK_ROWS;
+    size_t raw = n * sizeof(Row);
+    unsigned char* ubuf = (unsigned char*)malloc(raw);
+    uint32_t* table = (uint32_t*)malloc(sizeof(uint32_t) << LZ_HASH_BITS);
+    j->out[i] = (unsigned char*)malloc(lz_bound(raw));
+    if (ubuf && table && j->out[i]) {
+        itz_pack(j->v->data + a, n, ubuf);
+        j->csize[i] = lz_compress(ubuf, raw, j->out[i], table);
+    } else {
+        free(j->out[i]);                        /* write_itz reports ENOMEM */
+        j->out[i] = NULL;
+    }
+    free(ubuf);
+    free(table);
+}
+
+static int write_itz(const RowVec* v, const char* path) {
+    FILE* f = fopen(path, "wb");
+    if (!f) return errno;
+    uint32_t nblocks = (uint32_t)((v->len + ITZ_BLOCK_ROWS - 1) / ITZ_BLOCK_ROWS);
+    size_t batch = (size_t)par_threads() * 2;
+    ItzIndex* index = (ItzIndex*)calloc(nblocks ? nblocks : 1, sizeof(ItzIndex));
+    unsigned char** out = (unsigned char**)calloc(batch, sizeof(*out));
+    size_t* csize = (size_t*)calloc(batch, sizeof(*csize));
+    unsigned char hdr[ITZ_HDR] = { 0 };
+    int err = (!index || !out || !csize) ? ENOMEM : 0;
+    uint64_t pos = ITZ_HDR;
+    if (!err && fwrite(hdr, 1, sizeof(hdr), f) != sizeof(hdr)) err = errno;
+
+    for (size_t b0 = 0; b0 < nblocks && !err; b0 += batch) {
+        size_t nb = (nblocks - b0 < batch) ? nblocks - b0 : batch;
+        ItzSaveJob job = { v, b0, out, csize };
+        par_for(nb, itz_compress_one, &job);
+        for (size_t i = 0; i < nb; ++i) {
+            if (!err && !out[i]) err = ENOMEM;
+            if (!err && fwrite(out[i], 1, csize[i], f) != csize[i]) err = errno;
+            index[b0 + i].off = pos;
+            index[b0 + i].csize = (uint32_t)csize[i];
+            index[b0 + i].rows = (uint32_t)((v->len - (b0 + i) * ITZ_BLOCK_ROWS < ITZ_BLOCK_ROWS)
+                                            ? v->len - (b0 + i) * ITZ_BLOCK_ROWS : ITZ_BLOCK_ROWS);
+            pos += csize[i];
+            free(out[i]);
+            out[i] = NULL;
+        }
+    }
+
+    if (!err && fwrite(index, sizeof(ItzIndex), nblocks, f) != nblocks) err = errno;
+    if (!err) {
+        uint32_t rowsz = (uint32_t)sizeof(Row), block_rows = ITZ_BLOCK_ROWS;
+        uint64_t rows = (uint64_t)v->len;
+        memcpy(hdr, ITZ_MAGIC, 4);
+        memcpy(hdr + 4, &rowsz, 4);
+        memcpy(hdr + 8, &rows, 8);
+        memcpy(hdr + 16, &block_rows, 4);
+        memcpy(hdr + 20, &nblocks, 4);
+        memcpy(hdr + 24, &pos, 8);
+        if (fseek(f, 0, SEEK_SET) != 0 || fwrite(hdr, 1, sizeof(hdr), f) != sizeof(hdr)) err = errno;
+    }
+    if (fclose(f) != 0 && !err) err = errno;
+    free(index);
+    free(out);
+    free(csize);
+    return err;
+}
+
+/* Parallel full load into memory (--mem). Returns 0 or errno. */
+typedef struct {
+    ItzFile* z;
+    RowVec*  v;
+    int      err;
+} ItzLoadJob;
+
+static void itz_decompress_one(void* ctx, size_t b) {
+    ItzLoadJob* j = (ItzLoadJob*)ctx;
+    int err = itz_read_block(j->z->fd, &j->z->index[b], j->v->data + b * ITZ_BLOCK_ROWS);
+    if (err) __atomic_store_n(&j->err, err, __ATOMIC_RELAXED);
+}
+
+static int load_itz(const char* path, RowVec* v) {
+    ItzFile z;
+    int err = itz_open(&z, path);
+    if (err) return err;
+    size_t base = v->len;
+    if (base) { itz_close(&z); return EINVAL; }   /* blocks land at fixed offsets */
+    vec_reserve(v, (size_t)z.rows);
+    ItzLoadJob job = { &z, v, 0 };
+    par_for(z.nblocks, itz_decompress_one, &job);
+    if (!job.err) v->len = (size_t)z.rows;
+    itz_close(&z);
+    return job.err;
+}
+
+/* Paged view of an .itz: decodes only the blocks that pages touch and
+   keeps the last two decoded blocks, since a block spans many pages. */
+typedef struct {
+    RowSource       base;
+    ItzFile         z;
+    pthread_mutex_t mu;          /* UI and prefetch thread both read */
+    size_t          blk[2];
+    Row*            rows[2];
+    int             next_slot;
+} ItzSource;
+
+static size_t itz_src_count(RowSource* s) { return (size_t)((ItzSource*)s)->z.rows; }
+
+static int itz_src_read(RowSource* s, size_t a, size_t b, Row* out) {
+    ItzSource* zs = (ItzSource*)s;
+    int err = 0;
+    pthread_mutex_lock(&zs->mu);
+    while (a < b && !err) {
+        size_t blk = a / ITZ_BLOCK_ROWS;
+        if (blk >= zs->z.nblocks) { err = EINVAL; break; }
+        int slot = (zs->rows[0] && zs->blk[0] == blk) ? 0 : (zs->rows[1] && zs->blk[1] == blk) ? 1 : -1;
+        if (slot < 0) {
+            slot = zs->next_slot;
+            zs->next_slot ^= 1;
+            if (!zs->rows[slot]) zs->rows[slot] = (Row*)malloc(ITZ_BLOCK_ROWS * sizeof(Row));
+            if (!zs->rows[slot]) { err = ENOMEM; break; }
+            zs->blk[slot] = blk;
+            err = itz_read_block(zs->z.fd, &zs->z.index[blk], zs->rows[slot]);
+            if (err) { free(zs->rows[slot]); zs->rows[slot] = NULL; break; }
+        }
+        size_t blk_end = (blk + 1) * ITZ_BLOCK_ROWS;
+        size_t n = ((b < blk_end) ? b : blk_end) - a;
+        memcpy(out, zs->rows[slot] + (a - blk * ITZ_BLOCK_ROWS), n * sizeof(Row));
+        out += n;
+        a += n;
+    }
+    pthread_mutex_unlock(&zs->mu);
+    return err;
+}
+
+static void itz_src_close(RowSource* s) {
+    ItzSource* zs = (ItzSource*)s;
+    itz_close(&zs->z);
+    pthread_mutex_destroy(&zs->mu);
+    free(zs->rows[0]);
+    free(zs->rows[1]);
+    free(zs);
+}
+
+static RowSource* itz_source_open(const char* path) {
+    ItzSource* zs = (ItzSource*)calloc(1, sizeof(*zs));
+    if (!zs) return NULL;
+    int err = itz_open(&zs->z, path);
+    if (err) { free(zs); errno = err; return NULL; }
+    pthread_mutex_init(&zs->mu, NULL);
+    zs->base.name  = path;
+    zs->base.count = itz_src_count;
+    zs->base.read  = itz_src_read;
+    zs->base.write = NULL;
+    zs->base.close = itz_src_close;
+    return &zs->base;
+}
+
+/* ---------------------------------------------------------------------------
+ * Page cache in front of a RowSource.
+ * CACHE_PAGES pages of PAGE_ROWS rows each, LRU replacement, write-back of
+ * edited pages. A prefetch thread loads pages ahead of the scroll direction
+ * so that moving with j/k finds the next page already resident.
+ * All replacement decisions are made by the UI thread; the prefetcher only
+ * fills slots the UI thread reserved for it (state PG_LOADING). Dirty pages
+ * are written back outside the lock (state PG_WRITING); a page whose
+ * write-back fails stays dirty and the error is kept in wb_err.
+ * --------------------------------------------------------------------------- */
+#define PAGE_ROWS      256
+#define CACHE_PAGES    64
+#define PREFETCH_PAGES 2
+
+enum { PG_EMPTY = 0, PG_LOADING, PG_READY, PG_WRITING };
+
+typedef struct {
+    size_t page;                /* page number held in this slot */
+    int    state;               /* PG_* */
+    int    dirty;               /* edited since load; written back on eviction */
+    int    err;                 /* errno from the last load */
+    unsigned long long stamp;   /* LRU clock */
+    Row    rows[PAGE_ROWS];
+} Page;
+
+typedef struct {
+    RowSource* src;
+    size_t     len;
+    Page*      pages;           /* CACHE_PAGES slots */
+    unsigned long long tick;
+    unsigned long long hits, misses, prefetched;
+    int        wb_err;          /* errno of the last write-back, 0 once one succeeds */
+
+    pthread_t       th;
+    pthread_mutex_t mu;
+    pthread_cond_t  cv_work;    /* queue became non-empty / stop */
+    pthread_cond_t  cv_done;    /* a PG_LOADING slot finished */
+    Page*           queue[CACHE_PAGES];
+    size_t          qlen;
+    int             stop;
+} PageCache;
+
+static size_t page_rows(const PageCache* pc, size_t page) {
+    size_t a = page * PAGE_ROWS;
+    return (pc->len - a < PAGE_ROWS) ? pc->len - a : PAGE_ROWS;
+}
+
+static int page_load(PageCache* pc, Page* pg) {
+    size_t a = pg->page * PAGE_ROWS;
+    return pc->src->read(pc->src, a, a + page_rows(pc, pg->page), pg->rows);
+}
+
+static void* prefetch_main(void* arg) {
+    PageCache* pc = (PageCache*)arg;
+    pthread_mutex_lock(&pc->mu);
+    for (;;) {
+        while (!pc->stop && pc->qlen == 0) pthread_cond_wait(&pc->cv_work, &pc->mu);
+        if (pc->stop) break;
+        Page* pg = pc->queue[--pc->qlen];
+        pthread_mutex_unlock(&pc->mu);
+        int err = page_load(pc, pg);       /* I/O without the lock held */
+        pthread_mutex_lock(&pc->mu);
+        pg->err = err;
+        pg->state = err ? PG_EMPTY : PG_READY;
+        pc->prefetched++;
+        pthread_cond_broadcast(&pc->cv_done);
+    }
+    pthread_mutex_unlock(&pc->mu);
+    return NULL;
+}
+
+static PageCache* pc_open(RowSource* src) {
+    PageCache* pc = (PageCache*)calloc(1, sizeof(*pc));
+    if (!pc) return NULL;
+    pc->pages = (Page*)calloc(CACHE_PAGES, sizeof(Page));
+    if (!pc->pages) { free(pc); return NULL; }
+    pc->src = src;
+    pc->len = src->count(src);
+    pthread_mutex_init(&pc->mu, NULL);
+    pthread_cond_init(&pc->cv_work, NULL);
+    pthread_cond_init(&pc->cv_done, NULL);
+    if (pthread_create(&pc->th, NULL, prefetch_main, pc) != 0) {
+        free(pc->pages); free(pc); return NULL;
+    }
+    return pc;
+}
+
+/* Slot holding page, or NULL. Caller holds mu. */
+static Page* pc_lookup(PageCache* pc, size_t page) {
+    for (int i = 0; i < CACHE_PAGES; ++i) {
+        Page* pg = &pc->pages[i];
+        if (pg->state != PG_EMPTY && pg->page == page) return pg;
+    }
+    return NULL;
+}
+
+/* Write a dirty page back to the source with mu released; the page is
+   pinned as PG_WRITING meanwhile. On failure it stays dirty. Caller holds
+   mu and is the UI thread. Returns 0 or errno. */
+static int pc_writeback(PageCache* pc, Page* pg) {
+    size_t a = pg->page * PAGE_ROWS, n = page_rows(pc, pg->page);
+    int err = 0;
+    pg->state = PG_WRITING;
+    pthread_mutex_unlock(&pc->mu);
+    for (size_t i = 0; i < n && !err; ++i) err = pc->src->write(pc->src, a + i, &pg->rows[i]);
+    pthread_mutex_lock(&pc->mu);
+    pg->state = PG_READY;
+    pthread_cond_broadcast(&pc->cv_done);
+    if (!err) pg->dirty = 0;
+    pc->wb_err = err;
+    return err;
+}
+
+/* Pick an empty or least-recently-used settled slot, writing it back if
+   dirty. A page that cannot be written back is kept and the next oldest
+   tried; NULL if none can be freed. Caller holds mu. */
+static Page* pc_victim(PageCache* pc) {
+    for (int tries = 0; tries < CACHE_PAGES; ++tries) {
+        Page* best = NULL;
+        for (int i = 0; i < CACHE_PAGES; ++i) {
+            Page* pg = &pc->pages[i];
+            if (pg->state == PG_EMPTY) return pg;
+            if (pg->state == PG_READY && (!best || pg->stamp < best->stamp)) best = pg;
+        }
+        if (!best || !best->dirty || !pc->src->write) return best;
+        if (pc_writeback(pc, best) == 0) return best;
+        best->stamp = ++pc->tick;               /* keep its edits; try another slot */
+    }
+    return NULL;
+}
+
+/* Row idx of the paged table, or NULL on I/O error. The pointer stays valid
+   until the page is evicted, i.e. for the rest of the current frame. */
+static Row* pc_row(PageCache* pc, size_t idx) {
+    if (idx >= pc->len) return NULL;
+    size_t page = idx / PAGE_ROWS;
+    pthread_mutex_lock(&pc->mu);
+    Page* pg = pc_lookup(pc, page);
+    if (pg) {
+        pc->hits++;
+        while (pg->state == PG_LOADING || pg->state == PG_WRITING) pthread_cond_wait(&pc->cv_done, &pc->mu);
+    }
+    if (!pg || pg->state != PG_READY) {
+        pc->misses++;
+        pg = pc_victim(pc);
+        if (!pg) { pthread_mutex_unlock(&pc->mu); return NULL; }
+        pg->page = page;
+        pg->state = PG_LOADING;
+        pg->dirty = 0;
+        pthread_mutex_unlock(&pc->mu);
+        int err = page_load(pc, pg);
+        pthread_mutex_lock(&pc->mu);
+        pg->err = err;
+        pg->state = err ? PG_EMPTY : PG_READY;
+        pthread_cond_broadcast(&pc->cv_done);
+        if (err) { pthread_mutex_unlock(&pc->mu); return NULL; }
+    }
+    pg->stamp = ++pc->tick;
+    pthread_mutex_unlock(&pc->mu);
+    return &pg->rows[idx % PAGE_ROWS];
+}
+
+/* Queue the pages just beyond the viewport [first,last] in direction dir. */
+static void pc_prefetch(PageCache* pc, size_t first, size_t last, int dir) {
+    if (pc->len == 0) return;
+    size_t npages = (pc->len + PAGE_ROWS - 1) / PAGE_ROWS;
+    pthread_mutex_lock(&pc->mu);
+    for (size_t k = 1; k <= PREFETCH_PAGES; ++k) {
+        size_t page;
+        if (dir < 0) {
+            if (first / PAGE_ROWS < k) break;
+            page = first / PAGE_ROWS - k;
+        } else {
+            page = last / PAGE_ROWS + k;
+            if (page >= npages) break;
+        }
+        if (pc_lookup(pc, page) || pc->qlen >= CACHE_PAGES / 2) continue;
+        Page* pg = pc_victim(pc);
+        if (!pg) break;
+        pg->page = page;
+        pg->state = PG_LOADING;
+        pg->dirty = 0;
+        pg->stamp = ++pc->tick;   /* about to be used; don't evict right away */
+        pc->queue[pc->qlen++] = pg;
+    }
+    if (pc->qlen) pthread_cond_signal(&pc->cv_work);
+    pthread_mutex_unlock(&pc->mu);
+}
+
+/* Overwrite row idx through the cache (written back on eviction/close). */
+static int pc_write(PageCache* pc, size_t idx, const Row* r) {
+    if (!pc->src->write) return EROFS;
+    Row* dst = pc_row(pc, idx);
+    if (!dst) return EIO;
+    pthread_mutex_lock(&pc->mu);
+    *dst = *r;
+    pc_lookup(pc, idx / PAGE_ROWS)->dirty = 1;
+    pthread_mutex_unlock(&pc->mu);
+    return 0;
+}
+
+/* Write back every dirty page. Returns 0 or the first errno; pages that
+   failed stay dirty, so this can be retried. */
+static int pc_flush(PageCache* pc) {
+    int first = 0;
+    if (!pc->src->write) return 0;
+    pthread_mutex_lock(&pc->mu);
+    for (int i = 0; i < CACHE_PAGES; ++i) {
+        Page* pg = &pc->pages[i];
+        if (pg->state != PG_READY || !pg->dirty) continue;
+        int err = pc_writeback(pc, pg);
+        if (err && !first) first = err;
+    }
+    if (first) pc->wb_err = first;
+    pthread_mutex_unlock(&pc->mu);
+    return first;
+}
+
+/* Returns 0, or the errno of a write-back that failed (those edits are lost). */
+static int pc_close(PageCache* pc) {
+    int err = pc_flush(pc);
+    pthread_mutex_lock(&pc->mu);
+    pc->stop = 1;
+    pthread_cond_signal(&pc->cv_work);
+    pthread_mutex_unlock(&pc->mu);
+    pthread_join(pc->th, NULL);
+    pthread_mutex_destroy(&pc->mu);
+    pthread_cond_destroy(&pc->cv_work);
+    pthread_cond_destroy(&pc->cv_done);
+    pc->src->close(pc->src);
+    free(pc->pages);
+    free(pc);
+    return err;
+}
+
+/* ---------------------------------------------------------------------------
+ * Name index: an order-statistic B+tree over (name, row) for in-memory
+ * tables, ordered by ASCII-case-folded name with the row index as tie-break.
+ * Leaf entries carry the first 16 folded name bytes as two integers, so
+ * most comparisons never touch the RowVec. Inner nodes keep their own copy
+ * of each separator, so edits and deletes never invalidate them. Every node
+ * counts the entries below it: display position -> row and prefix ->
+ * position are both O(log n).
+ * The tree is updated on add/edit/delete. Underfull nodes are not merged,
+ * only emptied ones are freed; a rebuild (parallel sort + bulk load)
+ * repacks everything.
+ * --------------------------------------------------------------------------- */
+#define NIX_FANOUT 32
+#define NIX_FILL   24          /* entries per node after a bulk load */
+
+#define NIX_PFX 16
+
+typedef struct {
+    uint64_t pfx[2];           /* first NIX_PFX folded name bytes, big-endian */
+    size_t   row;
+} NixKey;
+
+typedef struct {
+    int    leaf;
+    int    n;
+    size_t count;                          /* entries in this subtree */
+    NixKey key[NIX_FANOUT];                /* leaf: entries; inner: separators */
+} NixNode;                                 /* a leaf, or the head of a NixInner */
+
+typedef struct {
+    NixNode  hdr;
+    char     sep_name[NIX_FANOUT][64];
+    NixNode* child[NIX_FANOUT];
+} NixInner;
+
+#define NIX_IN(nd) ((NixInner*)(nd))
+
+typedef struct {
+    const RowVec* vec;
+    NixNode*      root;
+} NameIndex;
+
+typedef struct {
+    NixKey      k;
+    const char* name;
+} NixProbe;
+
+static unsigned char nix_fold(unsigned char c) { return (c >= 'A' && c <= 'Z') ? c + 32 : c; }
+
+static NixKey nix_key(const char* s, size_t row) {
+    NixKey k = { { 0, 0 }, row };
+    for (int i = 0; i < NIX_PFX; ++i) {
+        unsigned char c = *s ? nix_fold((unsigned char)*s++) : 0;
+        k.pfx[i / 8] = (k.pfx[i / 8] << 8) | c;
+    }
+    return k;
+}
+
+static NixProbe nix_probe(const NameIndex* ix, size_t row) {
+    NixProbe p = { nix_key(ix->vec->data[row].name, row), ix->vec->data[row].name };
+    return p;
+}
+
+/* Equal prefixes: both names agree (folded) on their first NIX_PFX bytes,
+   and if either ended inside them, both did. Only the tail needs reading. */
+static int nix_cmp(const NixProbe* p, const NixKey* k, const char* name) {
+    if (p->k.pfx[0] != k->pfx[0]) return p->k.pfx[0] < k->pfx[0] ? -1 : 1;
+    if (p->k.pfx[1] != k->pfx[1]) return p->k.pfx[1] < k->pfx[1] ? -1 : 1;
+    if (k->pfx[1] & 0xff) {
+        const unsigned char* a = (const unsigned char*)p->name + NIX_PFX;
+        const unsigned char* b = (const unsigned char*)name + NIX_PFX;
+        while (*a && nix_fold(*a) == nix_fold(*b)) { a++; b++; }
+        if (nix_fold(*a) != nix_fold(*b)) return nix_fold(*a) < nix_fold(*b) ? -1 : 1;
+    }
+    return (p->k.row > k->row) - (p->k.row < k->row);
+}
+
+static int nix_cmp_entry(const NameIndex* ix, const NixProbe* p, const NixNode* nd, int i) {
+    return nix_cmp(p, &nd->key[i], ix->vec->data[nd->key[i].row].name);
+}
+
+static int nix_cmp_sep(const NixProbe* p, const NixNode* nd, int i) {
+    return nix_cmp(p, &nd->key[i], NIX_IN(nd)->sep_name[i]);
+}
+
+static NixNode* nix_node(int leaf) {
+    NixNode* nd = (NixNode*)calloc(1, leaf ? sizeof(NixNode) : sizeof(NixInner));
+    if (!nd) die_cleanup("Out of memory");
+    nd->leaf = leaf;
+    return nd;
+}
+
+static void nix_free_node(NixNode* nd) {
+    if (!nd->leaf) for (int i = 0; i < nd->n; ++i) nix_free_node(NIX_IN(nd)->child[i]);
+    free(nd);
+}
+
+/* Inner slot to descend into: last separator <= p (slot 0 takes the rest). */
+static int nix_slot(const NixNode* nd, const NixProbe* p) {
+    int lo = 1, hi = nd->n;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (nix_cmp_sep(p, nd, mid) < 0) hi = mid; else lo = mid + 1;
+    }
+    return lo - 1;
+}
+
+/* First leaf entry >= p */
+static int nix_leaf_lower(const NameIndex* ix, const NixNode* nd, const NixProbe* p) {
+    int lo = 0, hi = nd->n;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (nix_cmp_entry(ix, p, nd, mid) <= 0) hi = mid; else lo = mid + 1;
+    }
+    return lo;
+}
+
+/* Copy child's smallest key into nd's separator i */
+static void nix_set_sep(const NameIndex* ix, NixNode* nd, int i, const NixNode* child) {
+    nd->key[i] = child->key[0];
+    const char* name = child->leaf ? ix->vec->data[child->key[0].row].name : NIX_IN(child)->sep_name[0];
+    memcpy(NIX_IN(nd)->sep_name[i], name, sizeof(NIX_IN(nd)->sep_name[i]));
+}
+
+static NixNode* nix_split(NixNode* nd) {
+    NixNode* r = nix_node(nd->leaf);
+    int h = nd->n / 2;
+    r->n = nd->n - h;
+    memcpy(r->key, nd->key + h, (size_t)r->n * sizeof(NixKey));
+    if (nd->leaf) {
+        r->count = (size_t)r->n;
+    } else {
+        memcpy(NIX_IN(r)->sep_name, NIX_IN(nd)->sep_name + h, (size_t)r->n * sizeof(NIX_IN(nd)->sep_name[0]));
+        memcpy(NIX_IN(r)->child, NIX_IN(nd)->child + h, (size_t)r->n * sizeof(NixNode*));
+        for (int i = 0; i < r->n; ++i) r->count += NIX_IN(r)->child[i]->count;
+    }
+    nd->n = h;
+    nd->count -= r->count;
+    return r;
+}
+
+/* Insert below nd; returns the new right sibling if nd had to split. */
+static NixNode* nix_insert_at(const NameIndex* ix, NixNode* nd, const NixProbe* p) {
+    nd->count++;
+    if (nd->leaf) {
+        int i = nix_leaf_lower(ix, nd, p);
+        memmove(&nd->key[i+1], &nd->key[i], (size_t)(nd->n - i) * sizeof(NixKey));
+        nd->key[i] = p->k;
+        nd->n++;
+    } else {
+        int i = nix_slot(nd, p);
+        NixNode* sib = nix_insert_at(ix, NIX_IN(nd)->child[i], p);
+        if (sib) {
+            int at = i + 1;
+            memmove(&nd->key[at+1], &nd->key[at], (size_t)(nd->n - at) * sizeof(NixKey));
+            memmove(&NIX_IN(nd)->sep_name[at+1], &NIX_IN(nd)->sep_name[at], (size_t)(nd->n - at) * sizeof(NIX_IN(nd)->sep_name[0]));
+            memmove(&NIX_IN(nd)->child[at+1], &NIX_IN(nd)->child[at], (size_t)(nd->n - at) * sizeof(NixNode*));
+            NIX_IN(nd)->child[at] = sib;
+            nix_set_sep(ix, nd, at, sib);
+            nd->n++;
+        }
+    }
+    return (nd->n == NIX_FANOUT) ? nix_split(nd) : NULL;
+}
+
+static void nix_insert(NameIndex* ix, size_t row) {
+    NixProbe p = nix_probe(ix, row);
+    NixNode* sib = nix_insert_at(ix, ix->root, &p);
+    if (sib) {
+        NixNode* root = nix_node(0);
+        root->n = 2;
+        NIX_IN(root)->child[0] = ix->root;
+        NIX_IN(root)->child[1] = sib;
+        root->count = ix->root->count + sib->count;
+        nix_set_sep(ix, root, 0, ix->root);
+        nix_set_sep(ix, root, 1, sib);
+        ix->root = root;
+    }
+}
+
+static int nix_erase_at(const NameIndex* ix, NixNode* nd, const NixProbe* p) {
+    if (nd->leaf) {
+        int i = nix_leaf_lower(ix, nd, p);
+        if (i >= nd->n || nd->key[i].row != p->k.row) return 0;
+        memmove(&nd->key[i], &nd->key[i+1], (size_t)(nd->n - i - 1) * sizeof(NixKey));
+        nd->n--;
+    } else {
+        int i = nix_slot(nd, p);
+        if (!nix_erase_at(ix, NIX_IN(nd)->child[i], p)) return 0;
+        if (NIX_IN(nd)->child[i]->n == 0) {
+            free(NIX_IN(nd)->child[i]);
+            memmove(&nd->key[i], &nd->key[i+1], (size_t)(nd->n - i - 1) * sizeof(NixKey));
+            memmove(&NIX_IN(nd)->sep_name[i], &NIX_IN(nd)->sep_name[i+1], (size_t)(nd->n - i - 1) * sizeof(NIX_IN(nd)->sep_name[0]));
+            memmove(&NIX_IN(nd)->child[i], &NIX_IN(nd)->child[i+1], (size_t)(nd->n - i - 1) * sizeof(NixNode*));
+            nd->n--;
+        }
+    }
+    nd->count--;
+    return 1;
+}
+
+/* Remove row's entry; call while the row still holds the indexed name. */
+static void nix_erase(NameIndex* ix, size_t row) {
+    NixProbe p = nix_probe(ix, row);
+    nix_erase_at(ix, ix->root, &p);
+    while (!ix->root->leaf && ix->root->n == 1) {
+        NixNode* old = ix->root;
+        ix->root = NIX_IN(old)->child[0];
+        free(old);
+    }
+    if (!ix->root->leaf && ix->root->n == 0) {
+        free(ix->root);
+        ix->root = nix_node(1);
+    }
+}
+
+/* After vec_erase(row): rows above it moved down by one. */
+static void nix_shift_rows(NixNode* nd, size_t row) {
+    for (int i = 0; i < nd->n; ++i) {
+        if (nd->key[i].row > row) nd->key[i].row--;
+        if (!nd->leaf) nix_shift_rows(NIX_IN(nd)->child[i], row);
+    }
+}
+
+/* Row shown at display position pos */
+static size_t nix_row_at(const NameIndex* ix, size_t pos) {
+    const NixNode* nd = ix->root;
+    while (!nd->leaf) {
+        int i = 0;
+        while (i + 1 < nd->n && pos >= NIX_IN(nd)->child[i]->count) pos -= NIX_IN(nd)->child[i++]->count;
+        nd = NIX_IN(nd)->child[i];
+    }
+    return nd->key[pos].row;
+}
+
+/* Display position of the first entry >= p */
+static size_t nix_rank(const NameIndex* ix, const NixProbe* p) {
+    const NixNode* nd = ix->root;
+    size_t rank = 0;
+    while (!nd->leaf) {
+        int i = nix_slot(nd, p);
+        for (int j = 0; j < i; ++j) rank += NIX_IN(nd)->child[j]->count;
+        nd = NIX_IN(nd)->child[i];
+    }
+    return rank + (size_t)nix_leaf_lower(ix, nd, p);
+}
+
+static size_t nix_rank_of(const NameIndex* ix, size_t row) {
+    NixProbe p = nix_probe(ix, row);
+    return nix_rank(ix, &p);
+}
+
+/* Position of the first name >= prefix (case-insensitive) */
+static size_t nix_seek(const NameIndex* ix, const char* prefix) {
+    NixProbe p = { nix_key(prefix, 0), prefix };
+    return nix_rank(ix, &p);
+}
+
+static int nix_has_prefix(const char* name, const char* prefix) {
+    while (*prefix && nix_fold((unsigned char)*name) == nix_fold((unsigned char)*prefix)) { name++; prefix++; }
+    return *prefix == '\0';
+}
+
+/* Parallel rebuild: fill keys, sort runs on every core, merge runs pairwise
+   in parallel, then bulk-load leaves in parallel and stack inner levels. */
+static const RowVec* nix_sort_vec;       /* qsort has no context argument */
+
+static int nix_key_cmp(const void* a, const void* b) {
+    const NixKey* x = (const NixKey*)a;
+    const NixKey* y = (const NixKey*)b;
+    NixProbe p = { *x, nix_sort_vec->data[x->row].name };
+    return nix_cmp(&p, y, nix_sort_vec->data[y->row].name);
+}
+
+typedef struct {
+    NameIndex* ix;
+    NixKey*    keys;
+    NixKey*    tmp;
+    size_t     n;
+    size_t     run;        /* run length of the current pass */
+    NixNode**  nodes;
+} NixBuild;
+
+static void nix_fill_one(void* ctx, size_t c) {
+    NixBuild* b = (NixBuild*)ctx;
+    size_t a = c * b->run, e = (a + b->run < b->n) ? a + b->run : b->n;
+    for (size_t i = a; i < e; ++i) {
+        b->keys[i] = nix_key(b->ix->vec->data[i].name, i);
+    }
+    qsort(b->keys + a, e - a, sizeof(NixKey), nix_key_cmp);
+}
+
+static void nix_merge_one(void* ctx, size_t k) {
+    NixBuild* b = (NixBuild*)ctx;
+    size_t a = k * 2 * b->run;
+    size_t m = (a + b->run < b->n) ? a + b->run : b->n;
+    size_t e = (m + b->run < b->n) ? m + b->run : b->n;
+    size_t i = a, j = m, o = a;
+    while (i < m && j < e) b->tmp[o++] = (nix_key_cmp(&b->keys[j], &b->keys[i]) < 0) ? b->keys[j++] : b->keys[i++];
+    while (i < m) b->tmp[o++] = b->keys[i++];
+    while (j < e) b->tmp[o++] = b->keys[j++];
+}
+
+static void nix_leaf_one(void* ctx, size_t l) {
+    NixBuild* b = (NixBuild*)ctx;
+    size_t a = l * NIX_FILL, e = (a + NIX_FILL < b->n) ? a + NIX_FILL : b->n;
+    NixNode* nd = nix_node(1);
+    nd->n = (int)(e - a);
+    nd->count = e - a;
+    memcpy(nd->key, b->keys + a, (e - a) * sizeof(NixKey));
+    b->nodes[l] = nd;
+}
+
+static void nix_build(NameIndex* ix, const RowVec* v) {
+    NixBuild b;
+    memset(&b, 0, sizeof(b));
+    ix->vec = v;
+    ix->root = NULL;
+    b.ix = ix;
+    b.n = v->len;
+    if (b.n == 0) { ix->root = nix_node(1); return; }
+
+    b.keys = (NixKey*)malloc(b.n * sizeof(NixKey));
+    b.tmp  = (NixKey*)malloc(b.n * sizeof(NixKey));
+    if (!b.keys || !b.tmp) die_cleanup("Out of memory");
+    nix_sort_vec = v;
+    size_t runs = (size_t)par_threads();
+    b.run = (b.n + runs - 1) / runs;
+    par_for((b.n + b.run - 1) / b.run, nix_fill_one, &b);
+    for (; b.run < b.n; b.run *= 2) {
+        par_for((b.n + 2 * b.run - 1) / (2 * b.run), nix_merge_one, &b);
+        NixKey* t = b.keys; b.keys = b.tmp; b.tmp = t;
+    }
+
+    size_t level = (b.n + NIX_FILL - 1) / NIX_FILL;
+    b.nodes = (NixNode**)malloc(level * sizeof(NixNode*));
+    if (!b.nodes) die_cleanup("Out of memory");
+    par_for(level, nix_leaf_one, &b);
+    while (level > 1) {
+        size_t up = (level + NIX_FILL - 1) / NIX_FILL;
+        for (size_t u = 0; u < up; ++u) {
+            NixNode* nd = nix_node(0);
+            for (size_t c = u * NIX_FILL; c < level && c < (u + 1) * NIX_FILL; ++c) {
+                NIX_IN(nd)->child[nd->n] = b.nodes[c];
+                nix_set_sep(ix, nd, nd->n, b.nodes[c]);
+                nd->count += b.nodes[c]->count;
+                nd->n++;
+            }
+            b.nodes[u] = nd;
+        }
+        level = up;
+    }
+    ix->root = b.nodes[0];
+    free(b.nodes);
+    free(b.keys);
+    free(b.tmp);
+}
+
+static void nix_free(NameIndex* ix) {
+    if (ix->root) nix_free_node(ix->root);
+    ix->root = NULL;
+}
+
+/* ---------------------------------------------------------------------------
+ * ID order: a permutation of storage indices sorted by Row.id, built by an
+ * LSD radix sort. Each item is (id with its sign bit flipped) << 32 | row,
+ * so unsigned digit order is signed id order and ties keep storage order.
+ * Three passes of RADIX_BITS digits cover the 32-bit key. Each pass counts
+ * digits per chunk in parallel, turns the counts into per-chunk offsets
+ * with a prefix sum, then scatters every chunk in parallel; a pass whose
+ * digit is the same for every item is skipped. The order is rebuilt when
+ * rows are deleted or ids change, and extended in place when rows are
+ * appended with ids that keep it sorted.
+ * --------------------------------------------------------------------------- */
+#define RADIX_BITS  11
+#define RADIX_SIZE  (1u << RADIX_BITS)
+#define RADIX_CHUNK 65536             /* items per worker step */
+
+typedef struct {
+    uint32_t* perm;                   /* display position -> storage index */
+    size_t    len, cap;
+    int       stale;                  /* rows changed since the last build */
+} IdOrder;
+
+typedef struct {
+    const RowVec* v;
+    uint64_t*     src;
+    uint64_t*     dst;
+    uint32_t*     hist;               /* [chunk][digit]: count, then write offset */
+    size_t        n, nchunks;
+    int           shift;
+} RadixJob;
+
+static uint64_t radix_item(int id, size_t row) {
+    return (uint64_t)((uint32_t)id ^ 0x80000000u) << 32 | row;
+}
+
+static void radix_load_chunk(void* ctx, size_t c) {
+    RadixJob* j = (RadixJob*)ctx;
+    size_t end = (c + 1) * RADIX_CHUNK < j->n ? (c + 1) * RADIX_CHUNK : j->n;
+    for (size_t i = c * RADIX_CHUNK; i < end; ++i) j->src[i] = radix_item(j->v->data[i].id, i);
+}
+
+static void radix_count_chunk(void* ctx, size_t c) {
+    RadixJob* j = (RadixJob*)ctx;
+    uint32_t* h = j->hist + c * RADIX_SIZE;
+    size_t end = (c + 1) * RADIX_CHUNK < j->n ? (c + 1) * RADIX_CHUNK : j->n;
+    memset(h, 0, RADIX_SIZE * sizeof(uint32_t));
+    for (size_t i = c * RADIX_CHUNK; i < end; ++i) h[(j->src[i] >> (32 + j->shift)) & (RADIX_SIZE - 1)]++;
+}
+
+static void radix_scatter_chunk(void* ctx, size_t c) {
+    RadixJob* j = (RadixJob*)ctx;
+    uint32_t* h = j->hist + c * RADIX_SIZE;
+    size_t end = (c + 1) * RADIX_CHUNK < j->n ? (c + 1) * RADIX_CHUNK : j->n;
+    for (size_t i = c * RADIX_CHUNK; i < end; ++i) {
+        uint64_t x = j->src[i];
+        j->dst[h[(x >> (32 + j->shift)) & (RADIX_SIZE - 1)]++] = x;
+    }
+}
+
+/* Sort the n items in a (tmp: scratch of the same size). Returns the
+   buffer holding the result, a or tmp. */
+static uint64_t* radix_sort_items(RadixJob* j, uint64_t* a, uint64_t* tmp) {
+    j->src = a;
+    j->dst = tmp;
+    j->hist = (uint32_t*)malloc((j->nchunks ? j->nchunks : 1) * RADIX_SIZE * sizeof(uint32_t));
+    if (!j->hist) die_cleanup("Out of memory");
+    for (j->shift = 0; j->shift < 32; j->shift += RADIX_BITS) {
+        par_for(j->nchunks, radix_count_chunk, j);
+        size_t at = 0;
+        int skip = 0;
+        for (size_t d = 0; d < RADIX_SIZE && !skip; ++d) {
+            size_t start = at;
+            for (size_t c = 0; c < j->nchunks; ++c) {
+                uint32_t n = j->hist[c * RADIX_SIZE + d];
+                j->hist[c * RADIX_SIZE + d] = (uint32_t)at;
+                at += n;
+            }
+            skip = at - start == j->n;         /* one digit for everything */
+        }
+        if (skip) continue;
+        par_for(j->nchunks, radix_scatter_chunk, j);
+        uint64_t* t = j->src; j->src = j->dst; j->dst = t;
+    }
+    free(j->hist);
+    return j->src;
+}
+
+static void ido_free(IdOrder* o) { free(o->perm); o->perm = NULL; o->len = o->cap = 0; }
+
+/* Sort v's rows by id into o->perm. Returns 0, or -1 if v has more rows
+   than a 32-bit index can hold. */
+static int ido_build(IdOrder* o, const RowVec* v) {
+    if (v->len > UINT32_MAX) return -1;
+    RadixJob j;
+    memset(&j, 0, sizeof(j));
+    j.v = v;
+    j.n = v->len;
+    j.nchunks = (v->len + RADIX_CHUNK - 1) / RADIX_CHUNK;
+    uint64_t* a = (uint64_t*)malloc((v->len ? v->len : 1) * sizeof(uint64_t));
+    uint64_t* tmp = (uint64_t*)malloc((v->len ? v->len : 1) * sizeof(uint64_t));
+    if (!a || !tmp) die_cleanup("Out of memory");
+    j.src = a;
+    par_for(j.nchunks, radix_load_chunk, &j);
+    uint64_t* out = radix_sort_items(&j, a, tmp);
+    if (o->cap < v->len) {
+        free(o->perm);
+        o->cap = v->len + v->len / 4;
+        o->perm = (uint32_t*)malloc((o->cap ? o->cap : 1) * sizeof(uint32_t));
+        if (!o->perm) die_cleanup("Out of memory");
+    }
+    for (size_t i = 0; i < v->len; ++i) o->perm[i] = (uint32_t)out[i];
+    o->len = v->len;
+    o->stale = 0;
+    free(a);
+    free(tmp);
+    return 0;
+}
+
+/* Rows [before, v->len) were appended: extend the order in place when
+   their ids keep it sorted, else flag it for a rebuild. */
+static void ido_append(IdOrder* o, const RowVec* v, size_t before) {
+    if (o->stale || o->len != before || v->len > UINT32_MAX) { o->stale = 1; return; }
+    int last = o->len ? v->data[o->perm[o->len - 1]].id : INT_MIN;
+    for (size_t i = before; i < v->len; last = v->data[i++].id)
+        if (v->data[i].id < last) { o->stale = 1; return; }
+    if (o->cap < v->len) {
+        size_t ncap = o->cap * 2 > v->len ? o->cap * 2 : v->len;
+        uint32_t* np = (uint32_t*)realloc(o->perm, ncap * sizeof(uint32_t));
+        if (!np) die_cleanup("Out of memory");
+        o->perm = np;
+        o->cap = ncap;
+    }
+    for (size_t i = before; i < v->len; ++i) o->perm[o->len++] = (uint32_t)i;
+}
+
+/* Display position of storage index idx (a linear scan) */
+static size_t ido_rank(const IdOrder* o, size_t idx) {
+    if (o->len && o->perm[o->len - 1] == idx) return o->len - 1;   /* appended rows */
+    for (size_t p = 0; p < o->len; ++p) if (o->perm[p] == idx) return p;
+    return 0;
+}
+
+static int radix_item_cmp(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+/* --sort id --bench N: best of N radix sorts against qsort on the same
+   items; checks both orders agree. Returns an exit status. */
+static int ido_bench(const RowVec* v, size_t rounds) {
+    IdOrder o = { NULL, 0, 0, 0 };
+    uint64_t best_radix = UINT64_MAX, best_qsort = UINT64_MAX;
+    uint64_t* a = (uint64_t*)malloc((v->len ? v->len : 1) * sizeof(uint64_t));
+    if (!a) die_cleanup("Out of memory");
+    for (size_t r = 0; r < rounds; ++r) {
+        uint64_t t0 = prof_now_ns();
+        if (ido_build(&o, v) != 0) { fprintf(stderr, "Too many rows\n"); return 1; }
+        uint64_t t = prof_now_ns() - t0;
+        if (t < best_radix) best_radix = t;
+        t0 = prof_now_ns();
+        for (size_t i = 0; i < v->len; ++i) a[i] = radix_item(v->data[i].id, i);
+        qsort(a, v->len, sizeof(uint64_t), radix_item_cmp);
+        t = prof_now_ns() - t0;
+        if (t < best_qsort) best_qsort = t;
+    }
+    for (size_t i = 0; i < v->len; ++i)
+        if (o.perm[i] != (uint32_t)a[i]) { fprintf(stderr, "radix and qsort orders differ at %zu\n", i); return 1; }
+    printf("%zu rows by ID: radix %.1f ms, qsort %.1f ms (%.2fx)\n", v->len,
+           (double)best_radix / 1e6, (double)best_qsort / 1e6, (double)best_qsort / (double)(best_radix ? best_radix : 1));
+    free(a);
+    ido_free(&o);
+    return 0;
+}
+
+/* ---------------------------------------------------------------------------
+ * Row marks: a dense bitset over storage indices of an in-memory table,
+ * plus the batch operations that act on every marked row at once.
+ * --------------------------------------------------------------------------- */
+typedef struct {
+    uint64_t* w;
+    size_t    nbits;
+    size_t    count;       /* marked rows */
+} Marks;
+
+#define MARK_WORDS(n) (((n) + 63) / 64)
+
+static void marks_resize(Marks* m, size_t nbits) {
+    size_t old = MARK_WORDS(m->nbits), need = MARK_WORDS(nbits);
+    if (need > old) {
+        uint64_t* nw = (uint64_t*)realloc(m->w, need * sizeof(uint64_t));
+        if (!nw) die_cleanup("Out of memory");
+        memset(nw + old, 0, (need - old) * sizeof(uint64_t));
+        m->w = nw;
+    }
+    m->nbits = nbits;
+}
+
+static int marks_get(const Marks* m, size_t i) {
+    return i < m->nbits && (m->w[i >> 6] >> (i & 63)) & 1;
+}
+
+static void marks_set(Marks* m, size_t i, int on) {
+    if (i >= m->nbits || marks_get(m, i) == !!on) return;
+    m->w[i >> 6] ^= (uint64_t)1 << (i & 63);
+    m->count += on ? 1 : (size_t)-1;
+}
+
+static void marks_clear(Marks* m) {
+    if (m->w) memset(m->w, 0, MARK_WORDS(m->nbits) * sizeof(uint64_t));
+    m->count = 0;
+}
+
+static size_t marks_first(const Marks* m) {
+    for (size_t k = 0; k < MARK_WORDS(m->nbits); ++k)
+        if (m->w[k]) return (k << 6) + (size_t)__builtin_ctzll(m->w[k]);
+    return m->nbits;
+}
+
+static void marks_recount(Marks* m) {
+    m->count = 0;
+    for (size_t k = 0; k < MARK_WORDS(m->nbits); ++k) m->count += (size_t)__builtin_popcountll(m->w[k]);
+}
+
+/* Row idx was erased: bits above it move down by one */
+static void marks_erase(Marks* m, size_t idx) {
+    if (idx >= m->nbits) return;
+    marks_set(m, idx, 0);
+    size_t k = idx >> 6, nw = MARK_WORDS(m->nbits);
+    uint64_t low = m->w[k] & (((uint64_t)1 << (idx & 63)) - 1);
+    m->w[k] = low | ((m->w[k] >> 1) & ~(((uint64_t)1 << (idx & 63)) - 1));
+    for (; k + 1 < nw; ++k) {
+        m->w[k] |= (m->w[k+1] & 1) << 63;
+        m->w[k+1] >>= 1;
+    }
+    m->nbits--;
+}
+
+static void marks_free(Marks* m) { free(m->w); m->w = NULL; m->nbits = m->count = 0; }
+
+/* Stable compaction: keep the rows whose mark bit equals `keep`, in
+   order. Each worker counts the kept rows of one chunk of bitset words;
+   an exclusive prefix sum over the chunk counts gives every chunk its
+   output offset; then the workers scatter their kept runs (rows and extra
+   columns) with one memmove per run. Copies go to separate storage sized
+   to the kept rows. In place, a single worker goes chunk by chunk in
+   order (every run moves down, never up); with enough workers they first
+   pack each chunk to the front of its own range in parallel, then the
+   packed blocks slide down to their offsets in one serial pass, so no
+   extra memory is needed. The slide is a plain memmove of the kept rows
+   and costs about half of the serial compaction, so fewer workers would
+   not win it back. */
+#define COMPACT_CHUNK_WORDS 1024          /* 64K rows per worker step */
+#define COMPACT_PAR_THREADS 4             /* workers needed for the two-pass path */
+
+typedef struct {
+    const RowVec* src;
+    Row*          row;                    /* destination rows */
+    char**        col;                    /* destination extra columns */
+    const Marks*  m;
+    int           keep;                   /* 1 = keep marked rows, 0 = drop them */
+    size_t*       off;                    /* per chunk: kept count, then output offset */
+    int           local;                  /* pack each chunk to the front of its own range */
+} CompactJob;
+
+/* Word k of the kept-rows bitset, masked to the table */
+static uint64_t compact_word(const CompactJob* j, size_t k) {
+    uint64_t w = j->m->w && k < MARK_WORDS(j->m->nbits) ? j->m->w[k] : 0;
+    if (!j->keep) w = ~w;
+    size_t len = j->src->len;
+    if ((k + 1) << 6 > len) w &= ((uint64_t)1 << (len & 63)) - 1;
+    return w;
+}
+
+static void compact_count_chunk(void* ctx, size_t c) {
+    CompactJob* j = (CompactJob*)ctx;
+    size_t k1 = (c + 1) * COMPACT_CHUNK_WORDS, nw = MARK_WORDS(j->src->len), n = 0;
+    for (size_t k = c * COMPACT_CHUNK_WORDS; k < k1 && k < nw; ++k) n += (size_t)__builtin_popcountll(compact_word(j, k));
+    j->off[c] = n;
+}
+
+static void compact_copy_run(CompactJob* j, size_t a, size_t b, size_t out) {
+    if (out == a && j->row == j->src->data) return;    /* in place, nothing dropped yet */
+    memmove(&j->row[out], &j->src->data[a], (b - a) * sizeof(Row));
+    for (int c = 0; c < j->src->nextra; ++c) {
+        size_t es = col_elem_size(j->src->extra[c].type);
+        memmove(j->col[c] + out * es, (const char*)j->src->extra[c].data + a * es, (b - a) * es);
+    }
+}
+
+static void compact_scatter_chunk(void* ctx, size_t c) {
+    CompactJob* j = (CompactJob*)ctx;
+    size_t k1 = (c + 1) * COMPACT_CHUNK_WORDS, nw = MARK_WORDS(j->src->len);
+    size_t out = j->local ? (c * COMPACT_CHUNK_WORDS) << 6 : j->off[c];
+    size_t run = 0, run_len = 0;                       /* pending run of kept rows */
+    for (size_t k = c * COMPACT_CHUNK_WORDS; k < k1 && k < nw; ++k) {
+        uint64_t w = compact_word(j, k);
+        if (w == ~(uint64_t)0 && run_len && run + run_len == k << 6) { run_len += 64; continue; }
+        while (w) {
+            size_t i = (k << 6) + (size_t)__builtin_ctzll(w);
+            if (run_len && run + run_len == i) run_len++;
+            else {
+                if (run_len) { compact_copy_run(j, run, run + run_len, out); out += run_len; }
+                run = i; run_len = 1;
+            }
+            w &= w - 1;
+        }
+    }
+    if (run_len) compact_copy_run(j, run, run + run_len, out);
+}
+
+/* Count kept rows per chunk and turn the counts into output offsets.
+   Returns the total kept. */
+static size_t compact_offsets(CompactJob* j, size_t nchunks) {
+    j->off = (size_t*)malloc((nchunks ? nchunks : 1) * sizeof(size_t));
+    if (!j->off) die_cleanup("Out of memory");
+    par_for(nchunks, compact_count_chunk, j);
+    size_t total = 0;
+    for (size_t c = 0; c < nchunks; ++c) { size_t n = j->off[c]; j->off[c] = total; total += n; }
+    return total;
+}
+
+/* Copy the kept rows of src into row (room for the kept rows) and col (one
+   buffer per extra column). With row NULL only counts. Returns the number
+   of rows kept. */
+static size_t vec_compact_into(const RowVec* src, const Marks* m, int keep, Row* row, char** col) {
+    size_t nchunks = (MARK_WORDS(src->len) + COMPACT_CHUNK_WORDS - 1) / COMPACT_CHUNK_WORDS;
+    CompactJob j = { src, row, col, m, keep, NULL, 0 };
+    size_t total = compact_offsets(&j, nchunks);
+    if (row) par_for(nchunks, compact_scatter_chunk, &j);
+    free(j.off);
+    return total;
+}
+
+/* Drop (keep = 0) or keep only (keep = 1) the marked rows of v in place:
+   capacity is unchanged and the unused tail of the extra columns stays
+   zeroed. Returns the number of rows kept. */
+static size_t vec_compact(RowVec* v, const Marks* m, int keep) {
+    size_t nchunks = (MARK_WORDS(v->len) + COMPACT_CHUNK_WORDS - 1) / COMPACT_CHUNK_WORDS;
+    char** col = (char**)malloc((size_t)(v->nextra ? v->nextra : 1) * sizeof(char*));
+    if (!col) die_cleanup("Out of memory");
+    for (int c = 0; c < v->nextra; ++c) col[c] = (char*)v->extra[c].data;
+    CompactJob j = { v, v->data, col, m, keep, NULL, 0 };
+    size_t kept = compact_offsets(&j, nchunks);
+    if (par_threads() < COMPACT_PAR_THREADS || nchunks < 2) {
+        for (size_t c = 0; c < nchunks; ++c) compact_scatter_chunk(&j, c);
+    } else {
+        j.local = 1;
+        par_for(nchunks, compact_scatter_chunk, &j);
+        for (size_t c = 1; c < nchunks; ++c) {     /* chunk 0 is already in place */
+            size_t a = (c * COMPACT_CHUNK_WORDS) << 6;
+            size_t n = (c + 1 < nchunks ? j.off[c + 1] : kept) - j.off[c];
+            if (n && a != j.off[c]) {
+                memmove(&v->data[j.off[c]], &v->data[a], n * sizeof(Row));
+                for (int x = 0; x < v->nextra; ++x) {
+                    size_t es = col_elem_size(v->extra[x].type);
+                    memmove(col[x] + j.off[c] * es, col[x] + a * es, n * es);
+                }
+            }
+        }
+    }
+    for (int c = 0; c < v->nextra; ++c) {
+        size_t es = col_elem_size(v->extra[c].type);
+        memset(col[c] + kept * es, 0, (v->len - kept) * es);
+    }
+    free(j.off);
+    free(col);
+    v->len = kept;
+    return kept;
+}
+
+/* Build dst as a new table holding the marked rows of src, with copies of
+   its extra columns' dictionaries and string heaps. */
+static void vec_copy_marked(RowVec* dst, const RowVec* src, const Marks* m) {
+    size_t n = vec_compact_into(src, m, 1, NULL, NULL);
+    vec_init(dst);
+    dst->data = (Row*)malloc((n ? n : 1) * sizeof(Row));
+    dst->extra = (ColStore*)calloc((size_t)(src->nextra ? src->nextra : 1), sizeof(ColStore));
+    char** col = (char**)malloc((size_t)(src->nextra ? src->nextra : 1) * sizeof(char*));
+    if (!dst->data || !dst->extra || !col) die_cleanup("Out of memory");
+    dst->cap = n;
+    for (int c = 0; c < src->nextra; ++c) {
+        const ColStore* s = &src->extra[c];
+        ColStore* d = &dst->extra[c];
+        col_store_init(d, s->type, n);
+        for (uint32_t k = 1; k < s->dict.n; ++k) dict_intern(&d->dict, s->dict.str[k]);   /* same codes */
+        if (s->type == CT_STR) { heap_reserve(&d->heap, s->heap.len); memcpy(d->heap.buf, s->heap.buf, s->heap.len); d->heap.len = s->heap.len; }
+        col[c] = (char*)d->data;
+    }
+    dst->nextra = src->nextra;
+    dst->len = vec_compact_into(src, m, 1, dst->data, col);
+    free(col);
+}
+
+/* Delete every marked row in one stable parallel pass (vec_compact).
+   Returns the number of rows removed; marks are cleared. */
+static size_t vec_delete_marked(RowVec* v, Marks* m) {
+    size_t removed = v->len - vec_compact(v, m, 0);
+    marks_clear(m);
+    m->nbits = v->len;
+    return removed;
+}
+
+/* Set status on every marked row; each worker owns a run of bitset words */
+#define MARK_CHUNK_WORDS 1024
+
+typedef struct {
+    RowVec*      v;
+    const Marks* m;
+    char         status[sizeof(((Row*)0)->status)];   /* zero padded */
+} StatusJob;
+
+static void status_marked_chunk(void* ctx, size_t c) {
+    StatusJob* j = (StatusJob*)ctx;
+    size_t k0 = c * MARK_CHUNK_WORDS, k1 = k0 + MARK_CHUNK_WORDS, nw = MARK_WORDS(j->m->nbits);
+    if (k1 > nw) k1 = nw;
+    for (size_t k = k0; k < k1; ++k) {
+        for (uint64_t word = j->m->w[k]; word; word &= word - 1) {
+            size_t i = (k << 6) + (size_t)__builtin_ctzll(word);
+            memcpy(j->v->data[i].status, j->status, sizeof(j->status));
+        }
+    }
+}
+
+static void vec_set_status_marked(RowVec* v, const Marks* m, const char* status) {
+    StatusJob job;
+    job.v = v;
+    job.m = m;
+    memset(job.status, 0, sizeof(job.status));
+    snprintf(job.status, sizeof(job.status), "%s", status);
+    par_for((MARK_WORDS(m->nbits) + MARK_CHUNK_WORDS - 1) / MARK_CHUNK_WORDS, status_marked_chunk, &job);
+}
+
+/* Flag the snapshot chunks holding marked rows as written */
+static void marks_touch(const Marks* m, SnapStore* st) {
+    for (size_t k = 0; k < MARK_WORDS(m->nbits); ++k)
+        if (m->w[k]) snap_touch(st, k * 64, k * 64 + 64 < m->nbits ? k * 64 + 64 : m->nbits);
+}
+
+/* ---------------------------------------------------------------------------
+ * Duplicate IDs. Rows are radix-partitioned on a hash of their id, so all
+ * rows sharing an id land in one partition, and each partition is then
+ * checked on its own with a small open-addressing table that stays in
+ * cache. Partitioning is a parallel count / prefix sum / scatter over
+ * chunks of rows and keeps storage order, so the first entry seen for an
+ * id in a partition is its first row. Partitions are checked in parallel.
+ * --------------------------------------------------------------------------- */
+enum { DEDUP_CHECK, DEDUP_FIRST, DEDUP_LAST, DEDUP_MERGE };
+
+#define DEDUP_CHUNK     (1u << 20)      /* rows per partitioning step */
+#define DEDUP_PART_ROWS 32768           /* target rows per partition */
+#define DEDUP_MAX_BITS  12              /* at most 4096 partitions */
+#define DEDUP_MAX_ROWS  0x7ffffffeu     /* table slots hold row + 1 in 31 bits */
+#define DEDUP_SEEN      0x80000000u     /* slot flag: id already counted as duplicated */
+#define DEDUP_LOAD_ROWS (16u << 20)     /* larger tables skip the on-load check (12 B/row scratch) */
+
+typedef struct {
+    size_t ids;                          /* ids held by more than one row */
+    size_t rows;                         /* rows beyond the one kept per id */
+} DedupStats;
+
+typedef struct {
+    RowVec*   v;
+    int       policy;                    /* DEDUP_* */
+    int       bits;                      /* log2 of the partition count */
+    uint32_t* hist;                      /* [chunk][partition]: count, then write offset */
+    size_t*   part;                      /* [partition + 1]: first entry */
+    int32_t*  id;                        /* ids gathered by the count pass */
+    uint64_t* ent;                       /* (id << 32) | row, grouped by partition */
+    uint64_t* drop;                      /* bitset of rows to remove */
+    size_t    ids, rows;                 /* totals (atomic) */
+} DedupJob;
+
+/* "first", "last", "merge" or "check"; -1 if none of them */
+static int dedup_policy(const char* s) {
+    static const char* const names[] = { "check", "first", "last", "merge" };
+    for (int k = 0; k < 4; ++k) if (strcmp(s, names[k]) == 0) return k;
+    return -1;
+}
+
+static uint32_t dedup_hash(int id) {
+    return (uint32_t)(((uint64_t)(uint32_t)id * 0x9E3779B97F4A7C15ull) >> 32);
+}
+
+static uint32_t dedup_part(const DedupJob* j, int id) {
+    return j->bits ? dedup_hash(id) >> (32 - j->bits) : 0;
+}
+
+static void dedup_count_chunk(void* ctx, size_t c) {
+    DedupJob* j = (DedupJob*)ctx;
+    uint32_t* h = j->hist + (c << j->bits);
+    size_t end = (c + 1) * (size_t)DEDUP_CHUNK < j->v->len ? (c + 1) * (size_t)DEDUP_CHUNK : j->v->len;
+    for (size_t i = c * (size_t)DEDUP_CHUNK; i < end; ++i) {
+        int id = j->id[i] = j->v->data[i].id;            /* scatter then reads ids densely */
+        h[dedup_part(j, id)]++;
+    }
+}
+
+static void dedup_scatter_chunk(void* ctx, size_t c) {
+    DedupJob* j = (DedupJob*)ctx;
+    uint32_t* h = j->hist + (c << j->bits);
+    size_t end = (c + 1) * (size_t)DEDUP_CHUNK < j->v->len ? (c + 1) * (size_t)DEDUP_CHUNK : j->v->len;
+    for (size_t i = c * (size_t)DEDUP_CHUNK; i < end; ++i) {
+        int id = j->id[i];
+        uint32_t p = dedup_part(j, id);
+        j->ent[j->part[p] + h[p]++] = (uint64_t)(uint32_t)id << 32 | i;
+    }
+}
+
+/* Fold row b into row a: later values win, except that empty text
+   cells (Name, Status, dict, str) keep the earlier value */
+static void dedup_merge(RowVec* v, size_t a, size_t b) {
+    Row* ra = &v->data[a];
+    const Row* rb = &v->data[b];
+    if (rb->name[0])   memcpy(ra->name, rb->name, sizeof(ra->name));
+    if (rb->status[0]) memcpy(ra->status, rb->status, sizeof(ra->status));
+    for (int c = 0; c < v->nextra; ++c) {                /* numbers have no empty value */
+        const ColStore* cs = &v->extra[c];
+        if (cs->type == CT_DICT && !col_code(cs)[b]) continue;
+        if (cs->type == CT_STR && !col_str(cs, b)[0]) continue;
+        size_t es = col_elem_size(cs->type);
+        char* d = (char*)cs->data;
+        memcpy(d + a * es, d + b * es, es);
+    }
+}
+
+static void dedup_drop(DedupJob* j, size_t i) {
+    __atomic_fetch_or(&j->drop[i >> 6], (uint64_t)1 << (i & 63), __ATOMIC_RELAXED);
+}
+
+static void dedup_part_check(void* ctx, size_t p) {
+    DedupJob* j = (DedupJob*)ctx;
+    size_t a = j->part[p], n = j->part[p + 1] - a, ids = 0, rows = 0;
+    uint32_t cap = 16;
+    while (cap < 2 * n) cap <<= 1;
+    uint64_t* tab = (uint64_t*)calloc(cap, sizeof(uint64_t));   /* (id << 32) | flag | row + 1 */
+    if (!tab) die_cleanup("Out of memory");
+    for (size_t k = a; k < a + n; ++k) {
+        uint32_t id = (uint32_t)(j->ent[k] >> 32), row = (uint32_t)j->ent[k];
+        uint32_t s = dedup_hash((int)id) & (cap - 1);
+        while (tab[s] && (uint32_t)(tab[s] >> 32) != id) s = (s + 1) & (cap - 1);
+        if (!tab[s]) { tab[s] = (uint64_t)id << 32 | (row + 1); continue; }
+        uint32_t kept = ((uint32_t)tab[s] & ~DEDUP_SEEN) - 1;
+        if (!((uint32_t)tab[s] & DEDUP_SEEN)) { tab[s] |= DEDUP_SEEN; ids++; }
+        rows++;
+        switch (j->policy) {
+            case DEDUP_FIRST: dedup_drop(j, row); break;
+            case DEDUP_LAST:
+                dedup_drop(j, kept);
+                tab[s] = (uint64_t)id << 32 | DEDUP_SEEN | (row + 1);
+                break;
+            case DEDUP_MERGE: dedup_merge(j->v, kept, row); dedup_drop(j, row); break;
+        }
+    }
+    free(tab);
+    __atomic_fetch_add(&j->ids, ids, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&j->rows, rows, __ATOMIC_RELAXED);
+}
+
+/* Find rows sharing an id and, unless policy is DEDUP_CHECK, keep one per
+   id: the first, the last, or the first with the later rows' non-empty
+   cells merged in (MERGE). Kept rows stay in storage order. Returns 0, or
+   -1 if the table is too large to check. */
+static int vec_dedup(RowVec* v, int policy, DedupStats* st) {
+    DedupJob j;
+    memset(&j, 0, sizeof(j));
+    memset(st, 0, sizeof(*st));
+    if (v->len > DEDUP_MAX_ROWS) return -1;
+    if (v->len < 2) return 0;
+    j.v = v;
+    j.policy = policy;
+    while ((v->len >> j.bits) > DEDUP_PART_ROWS && j.bits < DEDUP_MAX_BITS) j.bits++;
+    size_t nparts = (size_t)1 << j.bits, nchunks = (v->len + DEDUP_CHUNK - 1) / DEDUP_CHUNK;
+    j.hist = (uint32_t*)calloc(nchunks << j.bits, sizeof(uint32_t));
+    j.part = (size_t*)malloc((nparts + 1) * sizeof(size_t));
+    j.id = (int32_t*)malloc(v->len * sizeof(int32_t));
+    j.ent = (uint64_t*)malloc(v->len * sizeof(uint64_t));
+    j.drop = (uint64_t*)calloc(MARK_WORDS(v->len), sizeof(uint64_t));
+    if (!j.hist || !j.part || !j.id || !j.ent || !j.drop) die_cleanup("Out of memory");
+    par_for(nchunks, dedup_count_chunk, &j);
+    size_t at = 0;                                       /* exclusive prefix sum */
+    for (size_t p = 0; p < nparts; ++p) {
+        j.part[p] = at;
+        size_t in = 0;
+        for (size_t c = 0; c < nchunks; ++c) {
+            uint32_t n = j.hist[(c << j.bits) + p];
+            j.hist[(c << j.bits) + p] = (uint32_t)in;
+            in += n;
+        }
+        at += in;
+    }
+    j.part[nparts] = at;
+    par_for(nchunks, dedup_scatter_chunk, &j);
+    free(j.id);
+    par_for(nparts, dedup_part_check, &j);
+    st->ids = j.ids;
+    st->rows = j.rows;
+    if (policy != DEDUP_CHECK && j.rows) {
+        Marks m = { j.drop, v->len, j.rows };
+        vec_delete_marked(v, &m);
+    }
+    free(j.drop);
+    free(j.ent);
+    free(j.part);
+    free(j.hist);
+    return 0;
+}
+
+/* ---------------------------------------------------------------------------
+ * Filter expressions, e.g.  status != "Active" && id > 5000 && name ~ "Item 0"
+ * An expression compiles to a small plan: comparison leaves on one column
+ * joined by &&, || and !. The plan runs over batches of FX_BATCH rows. Each
+ * node gets a selection vector of the rows still undecided and returns the
+ * ones that pass, so the right side of && only sees the rows the left side
+ * kept and the right side of || only the rows it dropped. A leaf is one
+ * loop over a column for the selected rows; the tree is walked once per
+ * batch, not once per row. Batches are spread over threads.
+ *
+ *   expr  := and { "||" and }        and := unary { "&&" unary }
+ *   unary := "!" unary | "(" expr ")" | column op value | word
+ *   op    := = == != < > <= >= ~ ^=  (~ contains, ignoring case; ^= starts with)
+ *   value := number | "quoted text" | word
+ *
+ * A lone word w means name ~ w, and text with no operator at all is one
+ * name search, spaces included.
+ * --------------------------------------------------------------------------- */
+#define FX_BATCH  1024            /* rows per batch, a multiple of 64 */
+#define FX_NODES  64
+
+enum { FX_CMP, FX_AND, FX_OR, FX_NOT };
+enum { FX_EQ, FX_NE, FX_LT, FX_GT, FX_LE, FX_GE, FX_HAS, FX_PRE };
+
+typedef struct FxNode FxNode;
+typedef struct FxPlan FxPlan;
+typedef size_t (*FxKernel)(const FxNode* nd, const RowVec* v, size_t base, const uint16_t* sel, size_t n, uint16_t* out);
+
+struct FxNode {
+    int      kind, op;
+    int      a, b;                /* children */
+    int      col;                 /* schema column */
+    int      num;                 /* compare as numbers */
+    int      is_int;              /* the literal is an exact integer */
+    int64_t  i64;
+    double   f64;
+    uint32_t code;                /* dict column: the literal's code, UINT32_MAX if absent */
+    char     str[128];
+    size_t   len;
+    char     low[128];            /* str folded to lower case, for ~ */
+    char     first[3];            /* both cases of its first letter, for strpbrk */
+    uint64_t pfx, pfx_mask;       /* first bytes of str (incl. its NUL for =), for Row fields */
+    size_t   off;                 /* Name/Status: field offset in Row */
+    FxKernel kernel;              /* specialized leaf, or NULL */
+};
+
+struct FxPlan {
+    FxNode        node[FX_NODES];
+    int           n, root;
+    const RowVec* v;
+    const char*   err;
+    int           interpret;      /* ignore kernels (for --bench) */
+};
+
+static void fx_space(const char** s) { while (**s == ' ' || **s == '\t') (*s)++; }
+
+static int fx_word_char(char c) {
+    return isalnum((unsigned char)c) || c == '_' || c == '.' || c == '-' || c == '+' || c == ':' || c == '/';
+}
+
+/* A quoted string or a bare word into out. Returns 0 or -1. */
+static int fx_token(const char** s, char* out, size_t outsz) {
+    size_t n = 0;
+    fx_space(s);
+    if (**s == '"') {
+        for ((*s)++; **s && **s != '"'; (*s)++) if (n + 1 < outsz) out[n++] = **s;
+        if (**s != '"') return -1;
+        (*s)++;
+    } else {
+        while (fx_word_char(**s)) { if (n + 1 < outsz) out[n++] = **s; (*s)++; }
+        if (n == 0) return -1;
+    }
+    out[n] = '\0';
+    return 0;
+}
+
+static int fx_node(FxPlan* p, int kind, int a, int b) {
+    if (p->n == FX_NODES) { p->err = "Expression too long"; return -1; }
+    FxNode* nd = &p->node[p->n];
+    memset(nd, 0, sizeof(*nd));
+    nd->kind = kind;
+    nd->a = a;
+    nd->b = b;
+    return p->n++;
+}
+
+static int fx_column(const char* name) {
+    for (int c = 0; c < g_schema.ncols; ++c)
+        if (strcasecmp(g_schema.col[c].name, name) == 0) return c;
+    return -1;
+}
+
+static uint32_t dict_find(const Dict* d, const char* s) {
+    if (!d->nslot) return UINT32_MAX;
+    uint32_t i = (uint32_t)str_hash(s) & (d->nslot - 1);
+    for (; d->slot[i]; i = (i + 1) & (d->nslot - 1))
+        if (strcmp(d->str[d->slot[i] - 1], s) == 0) return d->slot[i] - 1;
+    return UINT32_MAX;
+}
+
+/* column op value, or a lone word (name ~ word) */
+static int fx_leaf(FxPlan* p, const char** s) {
+    static const char* const ops[] = { "==", "!=", "<=", ">=", "^=", "=", "<", ">", "~" };
+    static const int op_of[] = { FX_EQ, FX_NE, FX_LE, FX_GE, FX_PRE, FX_EQ, FX_LT, FX_GT, FX_HAS };
+    char word[128];
+    if (fx_token(s, word, sizeof(word)) != 0) { p->err = "Expected a column or a word"; return -1; }
+    fx_space(s);
+    int k = 0;
+    while (k < 9 && strncmp(*s, ops[k], strlen(ops[k])) != 0) k++;
+    int id = fx_node(p, FX_CMP, -1, -1);
+    if (id < 0) return -1;
+    FxNode* nd = &p->node[id];
+    if (k == 9) {                                        /* lone word */
+        nd->col = fx_column("Name");
+        nd->op = FX_HAS;
+        snprintf(nd->str, sizeof(nd->str), "%s", word);
+        return id;
+    }
+    *s += strlen(ops[k]);
+    nd->op = op_of[k];
+    nd->col = fx_column(word);
+    if (nd->col < 0) { p->err = "Unknown column"; return -1; }
+    if (fx_token(s, nd->str, sizeof(nd->str)) != 0) { p->err = "Expected a value"; return -1; }
+
+    const ColumnDef* cd = &g_schema.col[nd->col];
+    int numeric_col = cd->field == FIELD_ID || (cd->field == FIELD_EXTRA && (cd->type == CT_INT64 || cd->type == CT_DOUBLE));
+    char* end;
+    nd->f64 = strtod(nd->str, &end);
+    int is_num = end != nd->str && *end == '\0';
+    if (numeric_col && nd->op != FX_HAS && nd->op != FX_PRE) {
+        if (!is_num) { p->err = "That column needs a number"; return -1; }
+        nd->num = 1;
+        long long v = strtoll(nd->str, &end, 10);
+        nd->is_int = *end == '\0';
+        nd->i64 = v;
+    }
+    nd->code = UINT32_MAX;
+    if (cd->field == FIELD_EXTRA && cd->type == CT_DICT && p->v && nd->col - BUILTIN_COLS < p->v->nextra)
+        nd->code = dict_find(&p->v->extra[nd->col - BUILTIN_COLS].dict, nd->str);
+    return id;
+}
+
+static int fx_or(FxPlan* p, const char** s);
+static void fx_specialize(FxPlan* p);
+
+static int fx_unary(FxPlan* p, const char** s) {
+    fx_space(s);
+    if (**s == '!' && (*s)[1] != '=') {
+        (*s)++;
+        int a = fx_unary(p, s);
+        return a < 0 ? -1 : fx_node(p, FX_NOT, a, -1);
+    }
+    if (**s == '(') {
+        (*s)++;
+        int a = fx_or(p, s);
+        fx_space(s);
+        if (a < 0) return -1;
+        if (**s != ')') { p->err = "Missing )"; return -1; }
+        (*s)++;
+        return a;
+    }
+    return fx_leaf(p, s);
+}
+
+static int fx_and(FxPlan* p, const char** s) {
+    int a = fx_unary(p, s);
+    for (fx_space(s); a >= 0 && strncmp(*s, "&&", 2) == 0; fx_space(s)) {
+        *s += 2;
+        int b = fx_unary(p, s);
+        a = b < 0 ? -1 : fx_node(p, FX_AND, a, b);
+    }
+    return a;
+}
+
+static int fx_or(FxPlan* p, const char** s) {
+    int a = fx_and(p, s);
+    for (fx_space(s); a >= 0 && strncmp(*s, "||", 2) == 0; fx_space(s)) {
+        *s += 2;
+        int b = fx_and(p, s);
+        a = b < 0 ? -1 : fx_node(p, FX_OR, a, b);
+    }
+    return a;
+}
+
+/* Precompute what the string kernels compare against */
+static void fx_prepare(FxNode* nd) {
+    unsigned char pfx[8] = { 0 }, mask[8] = { 0 };
+    nd->len = strlen(nd->str);
+    for (size_t i = 0; i <= nd->len; ++i) nd->low[i] = (char)nix_fold((unsigned char)nd->str[i]);
+    nd->first[0] = nd->low[0];
+    nd->first[1] = (char)toupper((unsigned char)nd->low[0]);
+    size_t cover = nd->op == FX_PRE ? nd->len : nd->len + 1;   /* = also checks the NUL */
+    for (size_t i = 0; i < 8 && i < cover; ++i) { pfx[i] = (unsigned char)nd->str[i]; mask[i] = 0xff; }
+    memcpy(&nd->pfx, pfx, 8);
+    memcpy(&nd->pfx_mask, mask, 8);
+    int field = nd->col >= 0 ? g_schema.col[nd->col].field : FIELD_EXTRA;   /* -1 after a parse error */
+    size_t fsz = field == FIELD_NAME ? sizeof(((Row*)0)->name) : field == FIELD_STATUS ? sizeof(((Row*)0)->status) : 0;
+    if (fsz && nd->len >= fsz && nd->op != FX_PRE) {   /* cannot fit the field: never equal, */
+        nd->pfx = 1;                                   /* and fx_field_eq never reads past it */
+        nd->pfx_mask = 0;
+    }
+}
+
+/* Compile text against table v (dict literals resolve to codes).
+   Returns 0, or -1 with p->err set. */
+static int fx_compile(FxPlan* p, const RowVec* v, const char* text) {
+    const char* s = text;
+    memset(p, 0, sizeof(*p));
+    p->v = v;
+    p->root = fx_or(p, &s);
+    fx_space(&s);
+    if (p->root >= 0 && *s) { p->err = "Unexpected text after the expression"; p->root = -1; }
+    if (p->root < 0 && !strpbrk(text, "=!<>~^&|()\"")) {   /* plain text: one name search */
+        memset(p, 0, sizeof(*p));
+        p->v = v;
+        p->root = fx_node(p, FX_CMP, -1, -1);
+        p->node[0].col = fx_column("Name");
+        p->node[0].op = FX_HAS;
+        snprintf(p->node[0].str, sizeof(p->node[0].str), "%s", text);
+    }
+    for (int i = 0; i < p->n; ++i) if (p->node[i].kind == FX_CMP) fx_prepare(&p->node[i]);
+    if (p->root >= 0) fx_specialize(p);
+    return p->root < 0 ? -1 : 0;
+}
+
+static int fx_test_i64(int op, int64_t x, int64_t c) {
+    switch (op) {
+        case FX_EQ: return x == c;
+        case FX_NE: return x != c;
+        case FX_LT: return x < c;
+        case FX_GT: return x > c;
+        case FX_LE: return x <= c;
+        default:    return x >= c;
+    }
+}
+
+static int fx_test_f64(int op, double x, double c) {
+    switch (op) {
+        case FX_EQ: return x == c;
+        case FX_NE: return x != c;
+        case FX_LT: return x < c;
+        case FX_GT: return x > c;
+        case FX_LE: return x <= c;
+        default:    return x >= c;
+    }
+}
+
+/* s contains the literal, ignoring ASCII case */
+static int fx_has(const FxNode* nd, const char* s) {
+    if (!nd->len) return 1;
+    for (; (s = strpbrk(s, nd->first)) != NULL; ++s) {
+        size_t k = 1;
+        while (k < nd->len && nix_fold((unsigned char)s[k]) == (unsigned char)nd->low[k]) k++;
+        if (k == nd->len) return 1;
+    }
+    return 0;
+}
 
+/* s equals the literal; s must have 8 readable bytes (a Row field).
+   fx_prepare guarantees len + 1 fits the field when the prefix matches. */
+static int fx_field_eq(const FxNode* nd, const char* s) {
+    uint64_t x;
+    memcpy(&x, s, 8);
+    return (x & nd->pfx_mask) == nd->pfx && (nd->len < 8 || memcmp(s, nd->str, nd->len + 1) == 0);
+}
 
-#define MAX_COLS 3
-#define COL0_W 6
-#define COL1_W 18
-#define COL2_W 12
+/* s starts with the literal; s must have 8 readable bytes */
+static int fx_field_pre(const FxNode* nd, const char* s) {
+    uint64_t x;
+    memcpy(&x, s, 8);
+    return (x & nd->pfx_mask) == nd->pfx && (nd->len <= 8 || strncmp(s + 8, nd->str + 8, nd->len - 8) == 0);
+}
+
+static int fx_test_str(const FxNode* nd, const char* s) {
+    if (nd->op == FX_HAS) return fx_has(nd, s);
+    if (nd->op == FX_PRE) return strncmp(s, nd->str, nd->len) == 0;
+    int c = strcmp(s, nd->str);
+    return fx_test_i64(nd->op, c, 0);
+}
+
+/* One leaf over the selected rows of the batch at base */
+static size_t fx_eval_leaf(const FxPlan* p, const FxNode* nd, size_t base, const uint16_t* sel, size_t n, uint16_t* out) {
+    const RowVec* v = p->v;
+    const Row* r = v->data + base;
+    const ColumnDef* cd = &g_schema.col[nd->col];
+    const ColStore* cs = cd->field == FIELD_EXTRA ? &v->extra[nd->col - BUILTIN_COLS] : NULL;
+    size_t m = 0;
+    if (nd->num && cd->field == FIELD_ID) {
+        for (size_t k = 0; k < n; ++k) {
+            out[m] = sel[k];
+            m += nd->is_int ? fx_test_i64(nd->op, r[sel[k]].id, nd->i64) : fx_test_f64(nd->op, r[sel[k]].id, nd->f64);
+        }
+    } else if (nd->num && cs->type == CT_INT64) {
+        const int64_t* x = col_i64(cs) + base;
+        for (size_t k = 0; k < n; ++k) {
+            out[m] = sel[k];
+            m += nd->is_int ? fx_test_i64(nd->op, x[sel[k]], nd->i64) : fx_test_f64(nd->op, (double)x[sel[k]], nd->f64);
+        }
+    } else if (nd->num) {
+        const double* x = col_f64(cs) + base;
+        for (size_t k = 0; k < n; ++k) { out[m] = sel[k]; m += fx_test_f64(nd->op, x[sel[k]], nd->f64); }
+    } else if ((cd->field == FIELD_NAME || cd->field == FIELD_STATUS) && (nd->op == FX_EQ || nd->op == FX_NE)) {
+        size_t off = cd->field == FIELD_NAME ? offsetof(Row, name) : offsetof(Row, status);
+        for (size_t k = 0; k < n; ++k) {
+            out[m] = sel[k];
+            m += fx_field_eq(nd, (const char*)&r[sel[k]] + off) == (nd->op == FX_EQ);
+        }
+    } else if (cs && cs->type == CT_DICT && (nd->op == FX_EQ || nd->op == FX_NE)) {
+        const uint32_t* x = col_code(cs) + base;
+        for (size_t k = 0; k < n; ++k) { out[m] = sel[k]; m += (x[sel[k]] == nd->code) == (nd->op == FX_EQ); }
+    } else {
+        for (size_t k = 0; k < n; ++k) {
+            char tmp[40]; int len;
+            const char* s = cell_text(&r[sel[k]], v, base + sel[k], nd->col, tmp, &len);
+            if (s == tmp) tmp[len] = '\0';
+            out[m] = sel[k];
+            m += fx_test_str(nd, s);
+        }
+    }
+    return m;
+}
+
+/* Specialized leaves: one function per (column kind, operator) pair,
+   stamped out by macros and picked when the plan is compiled, so the hot
+   loop has no switch, no type test and a constant comparison. Leaves
+   without a kernel (string order, str extras, ...) use fx_eval_leaf. */
+#define FX_KERNEL_HEAD(fn)                                                              \
+static size_t fn(const FxNode* nd, const RowVec* v, size_t base,                       \
+                 const uint16_t* sel, size_t n, uint16_t* out) {                       \
+    const Row* r = v->data + base;                                                      \
+    const ColStore* cs = g_schema.col[nd->col].field == FIELD_EXTRA ? &v->extra[nd->col - BUILTIN_COLS] : NULL; \
+    size_t m = 0;                                                                       \
+    (void)r; (void)cs;
+
+#define FX_CMP_KERNEL(fn, T, LOAD, LIT, OP)                                            \
+FX_KERNEL_HEAD(fn)                                                                      \
+    const T c = (T)(LIT);                                                               \
+    for (size_t k = 0; k < n; ++k) { size_t i = sel[k]; out[m] = sel[k]; m += (LOAD) OP c; } \
+    return m;                                                                           \
+}
+
+/* the six orderings, in FX_EQ..FX_GE order */
+#define FX_CMP_KERNELS(name, T, LOAD, LIT)                                             \
+    FX_CMP_KERNEL(name##_eq, T, LOAD, LIT, ==)                                          \
+    FX_CMP_KERNEL(name##_ne, T, LOAD, LIT, !=)                                          \
+    FX_CMP_KERNEL(name##_lt, T, LOAD, LIT, <)                                           \
+    FX_CMP_KERNEL(name##_gt, T, LOAD, LIT, >)                                           \
+    FX_CMP_KERNEL(name##_le, T, LOAD, LIT, <=)                                          \
+    FX_CMP_KERNEL(name##_ge, T, LOAD, LIT, >=)                                          \
+    static const FxKernel name[6] = { name##_eq, name##_ne, name##_lt, name##_gt, name##_le, name##_ge };
+
+FX_CMP_KERNELS(fxk_id_i,  int64_t, r[i].id,                      nd->i64)
+FX_CMP_KERNELS(fxk_id_f,  double,  (double)r[i].id,              nd->f64)
+FX_CMP_KERNELS(fxk_i64_i, int64_t, col_i64(cs)[base + i],         nd->i64)
+FX_CMP_KERNELS(fxk_i64_f, double,  (double)col_i64(cs)[base + i], nd->f64)
+FX_CMP_KERNELS(fxk_f64,   double,  col_f64(cs)[base + i],         nd->f64)
+
+/* dict code equality: enum-like columns */
+FX_CMP_KERNEL(fxk_code_eq, uint32_t, col_code(cs)[base + i], nd->code, ==)
+FX_CMP_KERNEL(fxk_code_ne, uint32_t, col_code(cs)[base + i], nd->code, !=)
+
+/* Name/Status field tests; nd->off is the field's offset in Row */
+#define FX_FIELD_KERNEL(fn, TEST)                                                      \
+FX_KERNEL_HEAD(fn)                                                                      \
+    const char* f = (const char*)r + nd->off;                                          \
+    for (size_t k = 0; k < n; ++k) { const char* s = f + sel[k] * sizeof(Row); out[m] = sel[k]; m += (TEST); } \
+    return m;                                                                           \
+}
+
+FX_FIELD_KERNEL(fxk_field_eq,  fx_field_eq(nd, s))
+FX_FIELD_KERNEL(fxk_field_ne,  !fx_field_eq(nd, s))
+FX_FIELD_KERNEL(fxk_field_pre, fx_field_pre(nd, s))
+FX_FIELD_KERNEL(fxk_field_has, fx_has(nd, s))
+
+/* Choose each leaf's kernel; NULL leaves run interpreted */
+static void fx_specialize(FxPlan* p) {
+    for (int i = 0; i < p->n; ++i) {
+        FxNode* nd = &p->node[i];
+        if (nd->kind != FX_CMP) continue;
+        const ColumnDef* cd = &g_schema.col[nd->col];
+        nd->kernel = NULL;
+        if (nd->num && cd->field == FIELD_ID)       nd->kernel = (nd->is_int ? fxk_id_i : fxk_id_f)[nd->op];
+        else if (nd->num && cd->type == CT_INT64)   nd->kernel = (nd->is_int ? fxk_i64_i : fxk_i64_f)[nd->op];
+        else if (nd->num)                           nd->kernel = fxk_f64[nd->op];
+        else if (cd->field == FIELD_NAME || cd->field == FIELD_STATUS) {
+            nd->off = cd->field == FIELD_NAME ? offsetof(Row, name) : offsetof(Row, status);
+            if (nd->op == FX_EQ)       nd->kernel = fxk_field_eq;
+            else if (nd->op == FX_NE)  nd->kernel = fxk_field_ne;
+            else if (nd->op == FX_PRE) nd->kernel = fxk_field_pre;
+            else if (nd->op == FX_HAS) nd->kernel = fxk_field_has;
+        } else if (cd->type == CT_DICT && (nd->op == FX_EQ || nd->op == FX_NE)) {
+            nd->kernel = nd->op == FX_EQ ? fxk_code_eq : fxk_code_ne;
+        }
+    }
+}
+
+/* a minus b; both ascending, b a subset of a */
+static size_t fx_minus(const uint16_t* a, size_t na, const uint16_t* b, size_t nb, uint16_t* out) {
+    size_t m = 0, j = 0;
+    for (size_t i = 0; i < na; ++i) {
+        if (j < nb && b[j] == a[i]) { j++; continue; }
+        out[m++] = a[i];
+    }
+    return m;
+}
+
+/* Rows of sel[0..n) passing node id, ascending, into out */
+static size_t fx_eval(const FxPlan* p, int id, size_t base, const uint16_t* sel, size_t n, uint16_t* out) {
+    const FxNode* nd = &p->node[id];
+    uint16_t a[FX_BATCH], b[FX_BATCH];
+    if (n == 0) return 0;
+    switch (nd->kind) {
+        case FX_AND: {
+            size_t na = fx_eval(p, nd->a, base, sel, n, a);
+            return fx_eval(p, nd->b, base, a, na, out);
+        }
+        case FX_OR: {
+            size_t na = fx_eval(p, nd->a, base, sel, n, a);
+            if (na == n) { memcpy(out, sel, n * sizeof(uint16_t)); return n; }
+            size_t nrest = fx_minus(sel, n, a, na, b);
+            size_t nb = fx_eval(p, nd->b, base, b, nrest, b);     /* in place: nodes read sel[k] before writing out[<=k] */
+            size_t i = 0, j = 0, m = 0;                            /* merge */
+            while (i < na || j < nb) out[m++] = (j == nb || (i < na && a[i] < b[j])) ? a[i++] : b[j++];
+            return m;
+        }
+        case FX_NOT: {
+            size_t na = fx_eval(p, nd->a, base, sel, n, a);
+            return fx_minus(sel, n, a, na, out);
+        }
+        default:
+            if (nd->kernel && !p->interpret) return nd->kernel(nd, p->v, base, sel, n, out);
+            return fx_eval_leaf(p, nd, base, sel, n, out);
+    }
+}
 
 typedef struct {
-    int id;
-    char name[64];
-    char status[32];
-} Row;
+    const FxPlan* p;
+    Marks*        m;              /* NULL: count only */
+    size_t        count;
+} FxJob;
+
+static void fx_batch(void* ctx, size_t bi) {
+    FxJob* j = (FxJob*)ctx;
+    const RowVec* v = j->p->v;
+    size_t base = bi * FX_BATCH, n = v->len - base < FX_BATCH ? v->len - base : FX_BATCH;
+    uint16_t sel[FX_BATCH], out[FX_BATCH];
+    for (size_t i = 0; i < n; ++i) sel[i] = (uint16_t)i;
+    size_t m = fx_eval(j->p, j->p->root, base, sel, n, out);
+    __atomic_fetch_add(&j->count, m, __ATOMIC_RELAXED);
+    if (!j->m) return;
+    uint64_t* w = j->m->w + base / 64;       /* this batch owns these words */
+    for (size_t k = 0; k < m; ++k) w[out[k] >> 6] |= (uint64_t)1 << (out[k] & 63);
+}
+
+/* Run the plan over every row; mark the matches when m is not NULL.
+   Returns the number of matching rows. */
+static size_t fx_run(const FxPlan* p, Marks* m) {
+    FxJob job = { p, m, 0 };
+    if (m) marks_resize(m, p->v->len);
+    par_for((p->v->len + FX_BATCH - 1) / FX_BATCH, fx_batch, &job);
+    if (m) marks_recount(m);
+    return job.count;
+}
 
+/* ---------------------------------------------------------------------------
+ * Table: what the UI draws. Either a fully resident RowVec (editable,
+ * rows can be added/deleted) or a paged source behind a PageCache.
+ * The UI works in display positions; with an order index set, position p
+ * shows the p-th row in name order instead of the p-th stored row.
+ * --------------------------------------------------------------------------- */
 typedef struct {
-    Row* data;
-    size_t len;
-    size_t cap;
-} RowVec;
+    RowVec*    vec;
+    PageCache* pc;
+    NameIndex* order;      /* in-memory tables only; NULL = storage order */
+    IdOrder*   by_id;      /* in-memory tables only; used instead of order when set */
+    Marks*     marks;      /* in-memory tables only */
+} Table;
 
-static void die_cleanup(const char* msg) {
-    endwin();
-    fprintf(stderr, "%s\n", msg);
-    exit(EXIT_FAILURE);
+static size_t table_len(const Table* t) { return t->vec ? t->vec->len : t->pc->len; }
+
+/* Storage index of the row at display position pos */
+static size_t table_index(const Table* t, size_t pos) {
+    if (t->by_id && pos < t->by_id->len) return t->by_id->perm[pos];
+    return (t->order && pos < t->vec->len) ? nix_row_at(t->order, pos) : pos;
 }
 
-static void vec_init(RowVec* v) {
-    v->data = NULL; v->len = 0; v->cap = 0;
+/* Display position of storage index idx; the order must be current */
+static size_t table_rank(const Table* t, size_t idx) {
+    if (t->by_id) return ido_rank(t->by_id, idx);
+    return t->order ? nix_rank_of(t->order, idx) : idx;
 }
-static void vec_reserve(RowVec* v, size_t need) {
-    if (need <= v->cap) return;
-    size_t ncap = v->cap ? v->cap*2 : 8;
-    if (ncap < need) ncap = need;
-    Row* nd = (Row*)realloc(v->data, ncap * sizeof(Row));
-    if (!nd) die_cleanup("Out of memory");
-    v->data = nd; v->cap = ncap;
+
+static Row* table_row(Table* t, size_t pos) {
+    size_t idx = table_index(t, pos);
+    if (t->vec) return (idx < t->vec->len) ? &t->vec->data[idx] : NULL;
+    return pc_row(t->pc, idx);
 }
-static void vec_push(RowVec* v, Row r) {
-    vec_reserve(v, v->len+1);
-    v->data[v->len++] = r;
+
+/* ---------------------------------------------------------------------------
+ * Column width statistics. Each column keeps a histogram of cell lengths,
+ * seeded from a sample at load (scaled to the row count) and adjusted by
+ * +1/-1 on add, edit and delete, so it stays approximate but cheap. A
+ * column's width is the length that covers WSTAT_PCT of its cells, capped
+ * at WSTAT_MAX, so one outlier does not widen it. The layout is
+ * recomputed only after the statistics change.
+ * --------------------------------------------------------------------------- */
+#define WSTAT_SAMPLE  65536     /* rows sampled at load */
+#define WSTAT_PAGES   8         /* paged sources: pages sampled */
+#define WSTAT_PCT     99        /* percent of cells a width must fit */
+
+static int g_layout_dirty;
+
+static void stats_cell(int col, int len, int64_t w) {
+    WidthStats* ws = &g_schema.col[col].ws;
+    if (len > WSTAT_MAX) len = WSTAT_MAX;
+    if (w < 0 && ws->hist[len] < (uint64_t)-w) w = -(int64_t)ws->hist[len];   /* estimates can undershoot */
+    ws->hist[len] += (uint64_t)w;
+    ws->total += (uint64_t)w;
+    g_layout_dirty = 1;
 }
-static void vec_erase(RowVec* v, size_t idx) {
-    if (idx >= v->len) return;
-    for (size_t i = idx+1; i < v->len; ++i) v->data[i-1] = v->data[i];
-    v->len--;
+
+/* Count (w > 0) or uncount (w < 0) every cell of a row w times */
+static void stats_row(const Row* r, const RowVec* v, size_t idx, int64_t w) {
+    for (int c = 0; c < g_schema.ncols; ++c) {
+        char tmp[32]; int len;
+        cell_text(r, v, idx, c, tmp, &len);
+        stats_cell(c, len, w);
+    }
 }
-static void vec_free(RowVec* v) { free(v->data); v->data=NULL; v->len=v->cap=0; }
 
-static void seed_data(RowVec* v) {
-    for (int i=1;i<=25;i++){
-        Row r;
-        r.id = i;
-        snprintf(r.name, sizeof(r.name), "Item %02d", i);
-        snprintf(r.status, sizeof(r.status), (i%3==0)?"Pending":(i%3==1)?"Active":"Paused");
-        vec_push(v, r);
+/* Seed the histograms from evenly spaced rows, each standing for its
+   share of the table. */
+static void stats_sample(Table* t) {
+    for (int c = 0; c < g_schema.ncols; ++c) memset(&g_schema.col[c].ws, 0, sizeof(WidthStats));
+    g_layout_dirty = 1;
+    if (t->vec) {
+        size_t n = t->vec->len, step = n > WSTAT_SAMPLE ? n / WSTAT_SAMPLE : 1;
+        for (size_t i = 0; i < n; i += step) stats_row(&t->vec->data[i], t->vec, i, (int64_t)step);
+        return;
+    }
+    /* paged: read a few pages straight from the source, bypassing the cache */
+    size_t n = t->pc->len;
+    if (n == 0) return;
+    Row* buf = (Row*)malloc(PAGE_ROWS * sizeof(Row));
+    if (!buf) return;
+    size_t pages = (n + PAGE_ROWS - 1) / PAGE_ROWS;
+    size_t take = pages < WSTAT_PAGES ? pages : WSTAT_PAGES;
+    size_t rows = take * PAGE_ROWS < n ? take * PAGE_ROWS : n;
+    int64_t w = (int64_t)(n / rows);
+    for (size_t k = 0; k < take; ++k) {
+        size_t a = (pages * k / take) * PAGE_ROWS, b = a + PAGE_ROWS < n ? a + PAGE_ROWS : n;
+        if (t->pc->src->read(t->pc->src, a, b, buf) != 0) continue;
+        for (size_t i = a; i < b; ++i) stats_row(&buf[i - a], NULL, i, w);
+    }
+    free(buf);
+}
+
+/* Recompute auto-sized widths and offsets if anything changed */
+static void schema_autosize(void) {
+    if (!g_layout_dirty) return;
+    g_layout_dirty = 0;
+    for (int c = 0; c < g_schema.ncols; ++c) {
+        ColumnDef* cd = &g_schema.col[c];
+        if (cd->fixed) continue;
+        int w = (int)strlen(cd->name);
+        uint64_t want = (cd->ws.total * WSTAT_PCT + 99) / 100, seen = 0;   /* rounded up */
+        for (int len = 0; len <= WSTAT_MAX && cd->ws.total; ++len) {
+            seen += cd->ws.hist[len];
+            if (seen >= want && cd->ws.hist[len]) { if (len > w) w = len; break; }
+        }
+        cd->width = w < WSTAT_MAX ? w : WSTAT_MAX;
+    }
+    schema_layout();
+}
+
+/* ---------------------------------------------------------------------------
+ * Screen output. The UI draws through the tui_* calls below. On an ANSI
+ * terminal they compose the frame in a cell buffer, and tui_refresh diffs
+ * it against the frame already on screen. Only changed cells are sent,
+ * with as few cursor moves and attribute changes as possible, in a single
+ * write(). Moving the selection one row then costs two rows of output
+ * instead of a repaint of the table, which is what matters over slow SSH.
+ * With --ncurses, or on a terminal whose cursor addressing is not ANSI,
+ * the same calls go straight to ncurses. Input is always read by ncurses.
+ * --------------------------------------------------------------------------- */
+enum { TUI_BOLD = 1, TUI_DIM = 2, TUI_UNDERLINE = 4, TUI_REVERSE = 8, TUI_LINE = 16 };
+
+/* Line-drawing glyphs, as DEC special graphics letters */
+enum { TUI_HLINE = 'q', TUI_VLINE = 'x', TUI_ULCORNER = 'l', TUI_URCORNER = 'k',
+       TUI_LLCORNER = 'm', TUI_LRCORNER = 'j' };
+
+#define TUI_GAP 6               /* rewrite this many unchanged cells rather than move */
+
+typedef struct {
+    char          ch;
+    unsigned char attr;         /* TUI_* */
+} TuiCell;
+
+typedef struct {
+    int      cells;             /* 1: cell buffer, 0: ncurses */
+    int      dec;               /* terminal has line drawing (smacs/rmacs) */
+    char     smacs[16], rmacs[16];
+    char     acs[128];          /* DEC glyph letter -> terminal's character */
+    int      h, w;
+    TuiCell* cur;               /* frame being drawn */
+    TuiCell* prev;              /* frame on screen */
+    int      valid;             /* prev matches the screen */
+    int      y, x;              /* draw position */
+    unsigned attr;              /* draw attributes */
+    int      cur_y, cur_x, cur_on;   /* cursor to show after the frame */
+    int      shown;             /* cursor visible on screen */
+    int      ty, tx;            /* terminal cursor while flushing; -1 = unknown */
+    unsigned pen;               /* terminal attributes while flushing */
+    char*    out;
+    size_t   out_len, out_cap;
+    uint64_t frames, bytes;     /* flushed so far */
+} Tui;
+
+static Tui g_tui;
+
+static int tui_cap(const char* name, char* out, size_t n) {
+    const char* s = tigetstr(name);
+    if (!s || s == (char*)-1 || strlen(s) >= n) return 0;
+    strcpy(out, s);
+    return 1;
+}
+
+/* Use the cell buffer unless told not to or the terminal is not ANSI.
+   Line drawing uses the terminal's own smacs/rmacs and acsc mapping. */
+static void tui_init(int want_cells) {
+    char cup[64], acsc[256];
+    memset(&g_tui, 0, sizeof(g_tui));
+    g_tui.cells = want_cells && tui_cap("cup", cup, sizeof(cup)) && strncmp(cup, "\033[", 2) == 0;
+    g_tui.dec = tui_cap("smacs", g_tui.smacs, sizeof(g_tui.smacs)) && tui_cap("rmacs", g_tui.rmacs, sizeof(g_tui.rmacs)) &&
+                tui_cap("acsc", acsc, sizeof(acsc));
+    for (size_t i = 0; g_tui.dec && acsc[i] && acsc[i + 1]; i += 2)
+        if ((unsigned char)acsc[i] < 128) g_tui.acs[(unsigned char)acsc[i]] = acsc[i + 1];
+    if (g_tui.dec && !(g_tui.acs[TUI_HLINE] && g_tui.acs[TUI_VLINE] && g_tui.acs[TUI_ULCORNER] &&
+                       g_tui.acs[TUI_URCORNER] && g_tui.acs[TUI_LLCORNER] && g_tui.acs[TUI_LRCORNER]))
+        g_tui.dec = 0;
+    if (!g_tui.dec) g_tui.rmacs[0] = '\0';
+}
+
+static void tui_size(int* h, int* w) { getmaxyx(stdscr, *h, *w); }
+
+static attr_t tui_curses_attr(unsigned a) {
+    return (a & TUI_BOLD ? A_BOLD : 0) | (a & TUI_DIM ? A_DIM : 0) |
+           (a & TUI_UNDERLINE ? A_UNDERLINE : 0) | (a & TUI_REVERSE ? A_REVERSE : 0);
+}
+
+static chtype tui_curses_ch(int ch) {
+    switch (ch) {
+        case TUI_HLINE:    return ACS_HLINE;
+        case TUI_VLINE:    return ACS_VLINE;
+        case TUI_ULCORNER: return ACS_ULCORNER;
+        case TUI_URCORNER: return ACS_URCORNER;
+        case TUI_LLCORNER: return ACS_LLCORNER;
+        case TUI_LRCORNER: return ACS_LRCORNER;
+    }
+    return (chtype)ch;
+}
+
+static void tui_attron(unsigned a)  { if (g_tui.cells) g_tui.attr |= a;  else attron(tui_curses_attr(a)); }
+static void tui_attroff(unsigned a) { if (g_tui.cells) g_tui.attr &= ~a; else attroff(tui_curses_attr(a)); }
+static void tui_move(int y, int x)  { if (g_tui.cells) { g_tui.y = y; g_tui.x = x; } else move(y, x); }
+
+/* Start a frame: size the buffer to the window and blank it */
+static void tui_erase(void) {
+    if (!g_tui.cells) { erase(); return; }
+    int h, w;
+    tui_size(&h, &w);
+    if (h != g_tui.h || w != g_tui.w || !g_tui.cur) {
+        size_t n = (size_t)(h > 0 ? h : 1) * (size_t)(w > 0 ? w : 1);
+        free(g_tui.cur);
+        free(g_tui.prev);
+        g_tui.cur = (TuiCell*)malloc(n * sizeof(TuiCell));
+        g_tui.prev = (TuiCell*)malloc(n * sizeof(TuiCell));
+        if (!g_tui.cur || !g_tui.prev) die_cleanup("Out of memory");
+        g_tui.h = h;
+        g_tui.w = w;
+        g_tui.valid = 0;
+    }
+    for (size_t i = 0; i < (size_t)g_tui.h * (size_t)g_tui.w; ++i) { g_tui.cur[i].ch = ' '; g_tui.cur[i].attr = 0; }
+    g_tui.y = g_tui.x = 0;
+    g_tui.attr = 0;
+    g_tui.cur_on = 0;
+}
+
+/* Put one cell at the draw position, clipped to the window */
+static void tui_cell(int ch, unsigned attr) {
+    if (g_tui.y >= 0 && g_tui.y < g_tui.h && g_tui.x >= 0 && g_tui.x < g_tui.w) {
+        TuiCell* c = &g_tui.cur[(size_t)g_tui.y * (size_t)g_tui.w + (size_t)g_tui.x];
+        if (attr & TUI_LINE && !g_tui.dec) {
+            ch = ch == TUI_HLINE ? '-' : ch == TUI_VLINE ? '|' : '+';
+            attr &= ~(unsigned)TUI_LINE;
+        } else if (!(attr & TUI_LINE) && (ch < 0x20 || ch > 0x7e)) {
+            ch = '?';                            /* one byte, one column */
+        }
+        c->ch = (char)(attr & TUI_LINE ? g_tui.acs[ch] : ch);
+        c->attr = (unsigned char)attr;
+    }
+    g_tui.x++;
+}
+
+static int tui_is_line(int ch) {
+    return ch == TUI_HLINE || ch == TUI_VLINE || ch == TUI_ULCORNER || ch == TUI_URCORNER ||
+           ch == TUI_LLCORNER || ch == TUI_LRCORNER;
+}
+
+static void tui_addnstr(const char* s, int n) {
+    if (!g_tui.cells) { addnstr(s, n); return; }
+    for (int i = 0; (n < 0 || i < n) && s[i]; ++i) tui_cell((unsigned char)s[i], g_tui.attr);
+}
+
+static void tui_mvaddnstr(int y, int x, const char* s, int n) { tui_move(y, x); tui_addnstr(s, n); }
+
+static void tui_vprintf(const char* fmt, va_list ap) {
+    char buf[1024];
+    vsnprintf(buf, sizeof(buf), fmt, ap);
+    tui_addnstr(buf, -1);
+}
+
+static void tui_printf(const char* fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    tui_vprintf(fmt, ap);
+    va_end(ap);
+}
+
+static void tui_mvprintf(int y, int x, const char* fmt, ...) {
+    va_list ap;
+    tui_move(y, x);
+    va_start(ap, fmt);
+    tui_vprintf(fmt, ap);
+    va_end(ap);
+}
+
+static void tui_clrtoeol(void) {
+    if (!g_tui.cells) { clrtoeol(); return; }
+    int x = g_tui.x;
+    while (g_tui.x < g_tui.w) tui_cell(' ', 0);
+    g_tui.x = x;
+}
+
+/* ch is a character or one of TUI_HLINE...TUI_LRCORNER */
+static void tui_addch(int y, int x, int ch) {
+    if (!g_tui.cells) { mvaddch(y, x, tui_curses_ch(ch)); return; }
+    tui_move(y, x);
+    tui_cell(ch, g_tui.attr | (tui_is_line(ch) ? TUI_LINE : 0));
+}
+
+static void tui_hline(int y, int x, int ch, int n) {
+    if (!g_tui.cells) { mvhline(y, x, tui_curses_ch(ch), n); return; }
+    for (int i = 0; i < n; ++i) tui_addch(y, x + i, ch);
+}
+
+static void tui_vline(int y, int x, int ch, int n) {
+    if (!g_tui.cells) { mvvline(y, x, tui_curses_ch(ch), n); return; }
+    for (int i = 0; i < n; ++i) tui_addch(y + i, x, ch);
+}
+
+/* Show the text cursor at (y, x) after the next refresh, or hide it */
+static void tui_cursor(int y, int x, int on) {
+    if (!g_tui.cells) { curs_set(on); move(y, x); return; }
+    g_tui.cur_y = y;
+    g_tui.cur_x = x;
+    g_tui.cur_on = on;
+}
+
+static void tui_out(const char* s, size_t n) {
+    if (g_tui.out_len + n > g_tui.out_cap) {
+        size_t ncap = g_tui.out_cap ? g_tui.out_cap * 2 : 16384;
+        while (ncap < g_tui.out_len + n) ncap *= 2;
+        char* nb = (char*)realloc(g_tui.out, ncap);
+        if (!nb) die_cleanup("Out of memory");
+        g_tui.out = nb;
+        g_tui.out_cap = ncap;
+    }
+    memcpy(g_tui.out + g_tui.out_len, s, n);
+    g_tui.out_len += n;
+}
+
+static void tui_goto(int y, int x) {
+    char seq[24];
+    if (g_tui.ty == y && g_tui.tx == x) return;
+    tui_out(seq, (size_t)snprintf(seq, sizeof(seq), "\033[%d;%dH", y + 1, x + 1));
+    g_tui.ty = y;
+    g_tui.tx = x;
+}
+
+/* Switch the terminal to attributes a (SGR and character set) */
+static void tui_pen(unsigned a) {
+    char seq[24];
+    size_t n = 0;
+    if ((a & ~(unsigned)TUI_LINE) != (g_tui.pen & ~(unsigned)TUI_LINE)) {
+        n = (size_t)snprintf(seq, sizeof(seq), "\033[0%s%s%s%sm", a & TUI_BOLD ? ";1" : "", a & TUI_DIM ? ";2" : "",
+                             a & TUI_UNDERLINE ? ";4" : "", a & TUI_REVERSE ? ";7" : "");
+        tui_out(seq, n);
+    }
+    if ((a & TUI_LINE) != (g_tui.pen & TUI_LINE)) {
+        const char* cs = a & TUI_LINE ? g_tui.smacs : g_tui.rmacs;
+        tui_out(cs, strlen(cs));
+    }
+    g_tui.pen = a;
+}
+
+/* Send the changed cells of row y */
+static void tui_flush_row(int y) {
+    TuiCell* a = g_tui.cur + (size_t)y * (size_t)g_tui.w;
+    TuiCell* b = g_tui.prev + (size_t)y * (size_t)g_tui.w;
+    int w = y == g_tui.h - 1 ? g_tui.w - 1 : g_tui.w;   /* the last cell would scroll */
+    for (int x = 0; x < w; ++x) {
+        if (a[x].ch == b[x].ch && a[x].attr == b[x].attr) continue;
+        /* a short run of unchanged cells in the current pen is cheaper to
+           resend than a cursor move */
+        if (g_tui.ty == y && g_tui.tx < x && x - g_tui.tx <= TUI_GAP) {
+            int k = g_tui.tx;
+            while (k < x && a[k].attr == g_tui.pen) ++k;
+            if (k == x) for (k = g_tui.tx; k < x; ++k) tui_out(&a[k].ch, 1);
+            if (k == x) g_tui.tx = x;
+        }
+        tui_goto(y, x);
+        tui_pen(a[x].attr);
+        tui_out(&a[x].ch, 1);
+        b[x] = a[x];
+        g_tui.tx = x + 1 < g_tui.w ? x + 1 : -1;          /* pending wrap: position unknown */
+        if (g_tui.tx < 0) g_tui.ty = -1;
+    }
+}
+
+/* Put the frame on screen */
+static void tui_refresh(void) {
+    if (!g_tui.cells) { refresh(); return; }
+    g_tui.out_len = 0;
+    g_tui.ty = g_tui.tx = -1;
+    g_tui.pen = 0;
+    if (!g_tui.valid) {
+        refresh();                               /* let ncurses finish its own clear first */
+        tui_out("\033[0m\033[H\033[2J", 11);
+        tui_out(g_tui.rmacs, strlen(g_tui.rmacs));
+        for (size_t i = 0; i < (size_t)g_tui.h * (size_t)g_tui.w; ++i) { g_tui.prev[i].ch = ' '; g_tui.prev[i].attr = 0; }
+        g_tui.ty = g_tui.tx = 0;
+        g_tui.valid = 1;
+    }
+    for (int y = 0; y < g_tui.h; ++y) tui_flush_row(y);
+    tui_pen(0);
+    if (g_tui.cur_on) {
+        tui_goto(g_tui.cur_y, g_tui.cur_x);
+        if (!g_tui.shown) tui_out("\033[?25h", 6);
+    } else if (g_tui.shown) {
+        tui_out("\033[?25l", 6);
+    }
+    g_tui.shown = g_tui.cur_on;
+    for (size_t off = 0; off < g_tui.out_len; ) {        /* one write, unless it is cut short */
+        ssize_t n = write(STDOUT_FILENO, g_tui.out + off, g_tui.out_len - off);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) { g_tui.valid = 0; break; }
+        off += (size_t)n;
+    }
+    g_tui.frames++;
+    g_tui.bytes += g_tui.out_len;
+}
+
+/* Read a line at (y, x) after prompt. Returns 0, or -1 if cancelled. */
+static int tui_read_line(int y, int x, const char* prompt, char* buf, int bufsz) {
+    int len = 0;
+    buf[0] = '\0';
+    for (;;) {
+        tui_mvaddnstr(y, x, prompt, -1);
+        tui_addnstr(buf, len);
+        tui_clrtoeol();
+        tui_cursor(y, x + (int)strlen(prompt) + len, 1);
+        tui_refresh();
+        int ch = getch();
+        if (ch == ERR) continue;                 /* frame tick */
+        if (ch == '\n' || ch == '\r' || ch == KEY_ENTER) break;
+        if (ch == 27) { len = -1; break; }
+        if ((ch == KEY_BACKSPACE || ch == 127 || ch == 8) && len > 0) buf[--len] = '\0';
+        else if (ch == 21) buf[len = 0] = '\0';  /* ^U */
+        else if (ch >= 0x20 && ch < 0x7f && len < bufsz - 1) { buf[len++] = (char)ch; buf[len] = '\0'; }
     }
+    tui_cursor(0, 0, 0);
+    if (len < 0) buf[0] = '\0';
+    return len < 0 ? -1 : 0;
 }
 
 static void draw_border(int top, int left, int width, int height) {
-    mvhline(top, left, 0, width);
-    mvhline(top+height-1, left, 0, width);
-    mvvline(top, left, 0, height);
-    mvvline(top, left+width-1, 0, height);
-    mvaddch(top, left, ACS_ULCORNER);
-    mvaddch(top, left+width-1, ACS_URCORNER);
-    mvaddch(top+height-1, left, ACS_LLCORNER);
-    mvaddch(top+height-1, left+width-1, ACS_LRCORNER);
+    tui_hline(top, left, TUI_HLINE, width);
+    tui_hline(top+height-1, left, TUI_HLINE, width);
+    tui_vline(top, left, TUI_VLINE, height);
+    tui_vline(top, left+width-1, TUI_VLINE, height);
+    tui_addch(top, left, TUI_ULCORNER);
+    tui_addch(top, left+width-1, TUI_URCORNER);
+    tui_addch(top+height-1, left, TUI_LLCORNER);
+    tui_addch(top+height-1, left+width-1, TUI_LRCORNER);
 }
 
 static int prompt_line_input(int y, int x, int maxlen, const char* prompt, char* buf, int bufsz) {
+    if (g_tui.cells) {
+        int rc = tui_read_line(y, x, prompt, buf, bufsz);
+        g_prof_waited = 1;
+        return rc;
+    }
     echo();
     curs_set(1);
     mvprintw(y, x, "%s", prompt);
     clrtoeol();
     move(y, x + (int)strlen(prompt));
     int res = wgetnstr(stdscr, buf, bufsz-1);
+    g_prof_waited = 1;
     noecho();
     curs_set(0);
     return (res == OK) ? 0 : -1;
 }
 
 static void show_message_center(const char* msg) {
-    int h,w; getmaxyx(stdscr, h, w);
+    int h,w; tui_size(&h, &w);
     int y = h/2, x = (w - (int)strlen(msg))/2;
-    attron(A_BOLD);
-    mvprintw(y, x<0?0:x, "%s", msg);
-    attroff(A_BOLD);
-    refresh();
+    tui_attron(TUI_BOLD);
+    tui_mvprintf(y, x<0?0:x, "%s", msg);
+    tui_attroff(TUI_BOLD);
+    tui_refresh();
+    g_prof_waited = 1;          // callers wait for a key next
 }
 
-static void show_details(const Row* r) {
-    int h,w; getmaxyx(stdscr, h, w);
-    int box_w = 40, box_h = 7;
+static void show_details(const Row* r, const RowVec* v, size_t idx) {
+    int h,w; tui_size(&h, &w);
+    int box_w = 40, box_h = g_schema.ncols + 4;
+    if (box_h > h) box_h = h;
     int top = (h - box_h)/2;
     int left = (w - box_w)/2;
     // backdrop
-    attron(A_DIM);
-    for (int i=0;i<h;i++){ mvhline(i, 0, ' ', w); }
-    attroff(A_DIM);
+    tui_attron(TUI_DIM);
+    for (int i=0;i<h;i++){ tui_hline(i, 0, ' ', w); }
+    tui_attroff(TUI_DIM);
 
     // modal
     draw_border(top, left, box_w, box_h);
-    mvprintw(top+1, left+2, "Row details");
-    mvhline(top+2, left+1, ACS_HLINE, box_w-2);
-    mvprintw(top+3, left+2, "ID: %d", r->id);
-    mvprintw(top+4, left+2, "Name: %s", r->name);
-    mvprintw(top+5, left+2, "Status: %s", r->status);
-    mvprintw(top+box_h, left+2, " ");
-    mvprintw(top+box_h-1, left+2, "Press any key to return");
-    refresh();
+    tui_mvprintf(top+1, left+2, "Row details");
+    tui_hline(top+2, left+1, TUI_HLINE, box_w-2);
+    for (int c = 0; c < g_schema.ncols && 3 + c < box_h - 1; ++c) {
+        char tmp[32]; int len;
+        const char* text = cell_text(r, v, idx, c, tmp, &len);
+        tui_mvprintf(top+3+c, left+2, "%s: %.*s", g_schema.col[c].name, len, text);
+    }
+    tui_mvprintf(top+box_h, left+2, " ");
+    tui_mvprintf(top+box_h-1, left+2, "Press any key to return");
+    tui_refresh();
     getch();
+    g_prof_waited = 1;
+}
+
+/* Append one cell as " text " padded/cut to width; returns new length */
+static size_t put_cell(char* line, size_t len, const char* text, int tlen, int width) {
+    line[len++] = ' ';
+    if (tlen > width) tlen = width;
+    memcpy(line + len, text, (size_t)tlen);
+    memset(line + len + tlen, ' ', (size_t)(width - tlen));
+    len += (size_t)width;
+    line[len++] = ' ';
+    return len;
+}
+
+/* Total cells a full line takes */
+static int schema_line_width(void) { return g_schema.col_x[g_schema.ncols]; }
+
+/* Frozen columns are ignored when they alone fill the window */
+static int frozen_cols(int width) {
+    return g_schema.col_x[g_schema.frozen] < width ? g_schema.frozen : 0;
+}
+
+/* First scrolling column to show so that focus is fully visible, moving
+   as little as possible from the current first column. */
+static size_t col_scroll_fit(size_t focus, size_t first, int width) {
+    size_t fz = (size_t)frozen_cols(width);
+    int avail = width - g_schema.col_x[fz];
+    if (first < fz) first = fz;
+    if (focus < fz) return first;
+    if (focus < first) return focus;
+    while (first < focus && g_schema.col_x[focus+1] - g_schema.col_x[first] > avail) first++;
+    return first;
+}
+
+/* Columns that start inside the window: frozen ones, then from first on.
+   Returns how many were written to cols. */
+static int col_window(size_t first, int width, int* cols) {
+    int n = 0, x = 0, fz = frozen_cols(width);
+    for (int c = 0; c < fz; ++c) { cols[n++] = c; x += g_schema.col[c].width + 2; }
+    for (int c = (int)first; c < g_schema.ncols && x < width; ++c) { cols[n++] = c; x += g_schema.col[c].width + 2; }
+    return n;
 }
 
-static void draw_table(const RowVec* v, size_t sel, size_t col_focus, size_t scroll, int top, int left, int width, int height) {
+static void draw_table(Table* t, size_t sel, size_t col_focus, size_t first_col, size_t scroll, int top, int left, int width, int height) {
+    // Only the columns inside the window are formatted. Each row goes into
+    // one line written with a single addnstr; the selected row is split
+    // around the focused column to bold it.
+    char line[MAX_COLS * 80];
+    size_t cell_at[MAX_COLS + 1];
+    int cols[MAX_COLS], ncols, focus_at = -1;
+    size_t len = 0;
+    if (width < 0) width = 0;
+    ncols = col_window(first_col, width, cols);
+    for (int k = 0; k < ncols; ++k) {
+        const ColumnDef* cd = &g_schema.col[cols[k]];
+        if ((size_t)cols[k] == col_focus) focus_at = k;
+        len = put_cell(line, len, cd->name, (int)strlen(cd->name), cd->width);
+    }
+
     // Header
-    attron(A_BOLD | A_UNDERLINE);
-    mvprintw(top, left, " %-*s %-*s %-*s ",
-             COL0_W, "ID",
-             COL1_W, "Name",
-             COL2_W, "Status");
-    attroff(A_BOLD | A_UNDERLINE);
+    tui_attron(TUI_BOLD | TUI_UNDERLINE);
+    tui_mvaddnstr(top, left, line, (int)len < width ? (int)len : width);
+    tui_attroff(TUI_BOLD | TUI_UNDERLINE);
 
     int rows_area = height - 2; // minus header and footer
     size_t max_visible = (rows_area > 0) ? (size_t)rows_area : 0;
@@ -141,44 +4941,76 @@ static void draw_table(const RowVec* v, size_t sel, size_t col_focus, size_t scr
     for (size_t i = 0; i < max_visible; ++i) {
         size_t idx = scroll + i;
         int y = top + 1 + (int)i;
-        move(y, left);
-        clrtoeol();
-        if (idx >= v->len) continue;
-
-        const Row* r = &v->data[idx];
-        bool is_sel = (idx == sel);
-
-        if (is_sel) attron(A_REVERSE);
-        // draw each column; highlight focused column subtly
-        if (is_sel && col_focus == 0) attron(A_BOLD);
-        mvprintw(y, left, " %-*d ", COL0_W, r->id);
-        if (is_sel && col_focus == 0) attroff(A_BOLD);
-
-        if (is_sel && col_focus == 1) attron(A_BOLD);
-        printw(" %-*.*s ", COL1_W, COL1_W, r->name);
-        if (is_sel && col_focus == 1) attroff(A_BOLD);
+        tui_move(y, left);
+        tui_clrtoeol();
+        if (idx >= table_len(t)) continue;
 
-        if (is_sel && col_focus == 2) attron(A_BOLD);
-        printw(" %-*.*s ", COL2_W, COL2_W, r->status);
-        if (is_sel && col_focus == 2) attroff(A_BOLD);
+        const Row* r = table_row(t, idx);
+        if (!r) { tui_mvprintf(y, left, " <read error>"); continue; }
+        size_t row_idx = table_index(t, idx);
+        len = 0;
+        for (int k = 0; k < ncols; ++k) {
+            char tmp[32]; int tlen;
+            const char* text = cell_text(r, t->vec, row_idx, cols[k], tmp, &tlen);
+            cell_at[k] = len;
+            len = put_cell(line, len, text, tlen, g_schema.col[cols[k]].width);
+        }
+        cell_at[ncols] = len;
+        if (len && t->marks && marks_get(t->marks, row_idx)) line[0] = '*';
+        int n = (int)len < width ? (int)len : width;
 
-        if (is_sel) attroff(A_REVERSE);
+        if (idx != sel) { tui_mvaddnstr(y, left, line, n); continue; }
+        // selected: reverse the whole line, bold the focused column
+        int a = focus_at < 0 ? n : (int)cell_at[focus_at];
+        int b = focus_at < 0 ? n : (int)cell_at[focus_at + 1];
+        if (a > n) a = n;
+        if (b > n) b = n;
+        tui_attron(TUI_REVERSE);
+        tui_mvaddnstr(y, left, line, a);
+        tui_attron(TUI_BOLD);
+        tui_addnstr(line + a, b - a);
+        tui_attroff(TUI_BOLD);
+        tui_addnstr(line + b, n - b);
+        tui_attroff(TUI_REVERSE);
     }
 
     // Footer help
     int fy = top + height - 1;
-    move(fy, left);
-    clrtoeol();
-    attron(A_DIM);
-    mvprintw(fy, left, " Arrows/kjhl: Move  Enter: View  e: Edit  a: Add  d: Del  q: Quit ");
-    attroff(A_DIM);
+    tui_move(fy, left);
+    tui_clrtoeol();
+    tui_attron(TUI_DIM);
+    tui_mvprintf(fy, left, " Arrows/kjhl: Move  Enter: View  e: Edit  a: Add  d: Del  m/J/K: Mark  f: Filter  s: Status  n: Sort  /: Find  x: CSV  w: Save  q: Quit ");
+    tui_attroff(TUI_DIM);
+}
+
+/* Timings overlay: one line per span, drawn at (y, x) */
+static void draw_timings(int y, int x) {
+    char a[16], b[16], c[16];
+    if (x < 0) x = 0;
+    tui_attron(TUI_BOLD);
+    tui_mvprintf(y, x, "%-8s %8s %8s %8s %8s", "span", "count", "p50", "p99", "max");
+    tui_attroff(TUI_BOLD);
+    for (int s = 0; s < SPAN_COUNT; ++s) {
+        const Hist* h = &g_hist[s];
+        tui_mvprintf(y + 1 + s, x, "%-8s %8llu %8s %8s %8s", span_names[s],
+                 (unsigned long long)__atomic_load_n(&h->count, __ATOMIC_RELAXED),
+                 human_ns(prof_quantile(h, 0.50), a, sizeof(a)),
+                 human_ns(prof_quantile(h, 0.99), b, sizeof(b)),
+                 human_ns(__atomic_load_n(&h->max_ns, __ATOMIC_RELAXED), c, sizeof(c)));
+    }
+    if (g_tui.frames)
+        tui_mvprintf(y + 1 + SPAN_COUNT, x, "%-8s %8llu %8s %17llu B", "output", (unsigned long long)g_tui.frames, "avg",
+                     (unsigned long long)(g_tui.bytes / g_tui.frames));
+    tui_attron(TUI_DIM);
+    tui_mvprintf(y + 2 + SPAN_COUNT, x, "t: hide  u: dump to file");
+    tui_attroff(TUI_DIM);
 }
 
 static void edit_cell(Row* r, size_t col, int footer_y, int left) {
     char buf[128];
     int x = left;
-    switch (col) {
-        case 0: {
+    switch (g_schema.col[col].field) {
+        case FIELD_ID: {
             // edit ID as integer
             buf[0]='\0';
             if (prompt_line_input(footer_y, x, 10, "New ID: ", buf, sizeof(buf)) == 0) {
@@ -187,7 +5019,7 @@ static void edit_cell(Row* r, size_t col, int footer_y, int left) {
                 if (end && *end=='\0') r->id = (int)val;
             }
         } break;
-        case 1: {
+        case FIELD_NAME: {
             strncpy(buf, r->name, sizeof(buf)); buf[sizeof(buf)-1]='\0';
             if (prompt_line_input(footer_y, x, (int)sizeof(r->name)-1, "New Name: ", buf, sizeof(buf)) == 0) {
                 buf[sizeof(r->name)-1]='\0';
@@ -195,7 +5027,7 @@ static void edit_cell(Row* r, size_t col, int footer_y, int left) {
                 r->name[sizeof(r->name)-1]='\0';
             }
         } break;
-        case 2: {
+        case FIELD_STATUS: {
             strncpy(buf, r->status, sizeof(buf)); buf[sizeof(buf)-1]='\0';
             if (prompt_line_input(footer_y, x, (int)sizeof(r->status)-1, "New Status: ", buf, sizeof(buf)) == 0) {
                 buf[sizeof(r->status)-1]='\0';
@@ -205,6 +5037,16 @@ static void edit_cell(Row* r, size_t col, int footer_y, int left) {
         } break;
     }
 }
+
+/* Edit an extra (schema) column of an in-memory row. Returns 0, or -1 if
+   the input was rejected. */
+static int edit_extra(RowVec* v, size_t idx, size_t col, int footer_y, int left) {
+    char buf[256], prompt[64];
+    snprintf(prompt, sizeof(prompt), "New %s: ", g_schema.col[col].name);
+    buf[0] = '\0';
+    if (prompt_line_input(footer_y, left, (int)sizeof(buf)-1, prompt, buf, sizeof(buf)) != 0) return 0;
+    return col_set_text(&v->extra[col - BUILTIN_COLS], idx, buf);
+}
 //added in helpers to output memory
 typedef struct {
     unsigned long long rss_bytes;   // Resident Set Size (bytes)
@@ -297,11 +5139,191 @@ static void format_limit(char* out, size_t n, unsigned long long lim_bytes) {
     human_bytes(lim_bytes, out, n);
 }
 
+static int has_suffix(const char* s, const char* suffix) {
+    size_t n = strlen(s), m = strlen(suffix);
+    return n > m && strcmp(s + n - m, suffix) == 0;
+}
+
 //Here is main
 
-int main(void) {
+int main(int argc, char** argv) {
     RowVec vec; vec_init(&vec);
-    seed_data(&vec);
+    Table tab = { NULL, NULL, NULL, NULL, NULL };
+    NameIndex nix = { NULL, NULL };   // built on first use, then kept in sync
+    Marks marks = { NULL, 0, 0 };
+    IdOrder ido = { NULL, 0, 0, 0 };
+    SnapStore snap; snap_init(&snap);  // published only when a background task needs it
+    ExportTask xt; memset(&xt, 0, sizeof(xt));
+    char xt_note[160] = "";
+    const char* serve_path = NULL;
+    const char* client_path = NULL;
+    size_t bench = 0;
+    Server srv;
+    int serving = 0;
+    SrvWrite* wq = NULL;              // writes taken over from the server
+    const char* shm_name = NULL;
+    const char* shm_read = NULL;
+    const char* filter_expr = NULL;
+    const char* filter_out = NULL;
+    int dedup = -1;                   // --dedup policy, or -1
+    int sort_id = 0;                  // --sort id
+    int use_ncurses = 0;              // --ncurses: draw with ncurses, not the cell buffer
+    char dup_note[96] = "";
+    ShmPub shm;
+    int shm_on = 0;
+    size_t wq_cap = 0;
+
+    const char* open_path = NULL;
+    int load_mem = 0, gen = 0, follow = 0, follow_paused = 0;
+    Follow fol;
+    GenSpec spec; gen_spec_init(&spec);
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--mem") == 0) load_mem = 1;
+        else if (strcmp(argv[i], "--timings") == 0) g_prof_on = 1;
+        else if (strcmp(argv[i], "--follow") == 0) follow = 1;
+        else if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc) serve_path = argv[++i];
+        else if (strcmp(argv[i], "--client") == 0 && i + 1 < argc) client_path = argv[++i];
+        else if (strcmp(argv[i], "--shm") == 0 && i + 1 < argc) shm_name = argv[++i];
+        else if (strcmp(argv[i], "--shm-read") == 0 && i + 1 < argc) shm_read = argv[++i];
+        else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) filter_expr = argv[++i];
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) filter_out = argv[++i];
+        else if (strcmp(argv[i], "--ncurses") == 0) use_ncurses = 1;
+        else if (strcmp(argv[i], "--sort") == 0 && i + 1 < argc) {
+            if (strcmp(argv[++i], "id") != 0) { fprintf(stderr, "--sort takes id\n"); return 1; }
+            sort_id = 1;
+        }
+        else if (strcmp(argv[i], "--dedup") == 0 && i + 1 < argc) {
+            if ((dedup = dedup_policy(argv[++i])) < 0) { fprintf(stderr, "--dedup takes first, last, merge or check\n"); return 1; }
+        }
+        else if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc) bench = (size_t)strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--gen") == 0 && i + 1 < argc) { gen = 1; spec.rows = (size_t)strtoull(argv[++i], NULL, 10); }
+        else if (strcmp(argv[i], "--freeze") == 0 && i + 1 < argc) g_schema.frozen = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--schema") == 0 && i + 1 < argc) {
+            if (schema_parse(&vec, argv[++i]) != 0) { fprintf(stderr, "bad --schema: %s\n", argv[i]); return 1; }
+        }
+        else if (strncmp(argv[i], "--", 2) == 0) {
+            if (i + 1 >= argc || gen_spec_option(&spec, argv[i], argv[i+1]) != 0) {
+                fprintf(stderr, "bad option: %s %s\n", argv[i], i + 1 < argc ? argv[i+1] : "");
+                return 1;
+            }
+            ++i;
+        }
+        else open_path = argv[i];
+    }
+
+    if (client_path) return client_main(client_path, bench);
+    if (shm_read) return shm_read_main(shm_read, bench);
+
+    if (follow) {
+        if (!open_path) open_path = "-";
+        int rc = follow_open(&fol, open_path, &vec);
+        if (rc != 0) { fprintf(stderr, "%s: %s\n", open_path, strerror(rc)); return 1; }
+        follow_poll(&fol, (size_t)-1);           // everything already written
+        tab.vec = &vec;
+    } else if (gen) {
+        if (gen_spec_check(&spec) != 0) { fprintf(stderr, "--gen %zu: too many rows for these IDs\n", spec.rows); return 1; }
+        uint64_t t0 = span_begin();
+        gen_fill(&spec, &vec);
+        span_end(SPAN_GEN, t0);
+        tab.vec = &vec;
+    } else if (open_path && (has_suffix(open_path, ".csv") || (load_mem && has_suffix(open_path, ".itz")))) {
+        int rc = has_suffix(open_path, ".csv") ? load_csv(open_path, &vec) : load_itz(open_path, &vec);
+        if (rc != 0) { fprintf(stderr, "%s: %s\n", open_path, strerror(rc)); return 1; }
+        tab.vec = &vec;
+    } else if (open_path) {
+        RowSource* src;
+        if (strncmp(open_path, "gen:", 4) == 0) {
+            spec.rows = (size_t)strtoull(open_path + 4, NULL, 10);
+            if (gen_spec_check(&spec) != 0) { fprintf(stderr, "%s: too many rows for these IDs\n", open_path); return 1; }
+            src = gen_source_open(&spec);
+        }
+        else if (has_suffix(open_path, ".itz"))  src = itz_source_open(open_path);
+        else                                     src = file_source_open(open_path);
+        if (!src) { perror(open_path); return 1; }
+        tab.pc = pc_open(src);
+        if (!tab.pc) { src->close(src); fprintf(stderr, "Out of memory\n"); return 1; }
+    } else {
+        seed_data(&vec);
+        tab.vec = &vec;
+    }
+
+    if (tab.vec && (dedup >= 0 || vec.len <= DEDUP_LOAD_ROWS)) {   // duplicate IDs: check on load, or --dedup
+        DedupStats ds;
+        uint64_t t0 = prof_now_ns();
+        int policy = dedup < 0 ? DEDUP_CHECK : dedup;
+        if (vec_dedup(&vec, policy, &ds) == 0 && dedup >= 0)
+            fprintf(stderr, "%zu rows share an ID with another row (%zu IDs)%s, %.1f ms\n", ds.rows, ds.ids,
+                    policy == DEDUP_CHECK || !ds.rows ? "" : ", removed", (double)(prof_now_ns() - t0) / 1e6);
+        if (ds.rows && policy == DEDUP_CHECK) snprintf(dup_note, sizeof(dup_note), "dup IDs: %zu rows (i)", ds.rows);
+        if (dedup == DEDUP_CHECK && !filter_expr) { vec_free(&vec); return 0; }
+    }
+
+    if (sort_id && !tab.vec) { fprintf(stderr, "--sort needs an in-memory table\n"); return 1; }
+    if (sort_id && bench && !filter_expr) {      // radix vs comparison sort, then exit
+        int rc = ido_bench(&vec, bench);
+        vec_free(&vec);
+        return rc;
+    }
+
+    if (filter_expr) {                           // count matches and exit
+        FxPlan plan;
+        if (!tab.vec) { fprintf(stderr, "--filter needs an in-memory table\n"); return 1; }
+        if (fx_compile(&plan, &vec, filter_expr) != 0) { fprintf(stderr, "%s: %s\n", filter_expr, plan.err); return 1; }
+        uint64_t t0 = prof_now_ns();
+        size_t n = fx_run(&plan, NULL);
+        printf("%zu of %zu rows match (%.1f ms)\n", n, vec.len, (double)(prof_now_ns() - t0) / 1e6);
+        if (bench) {                             // best of N runs, each way
+            uint64_t best[2] = { UINT64_MAX, UINT64_MAX };
+            for (size_t r = 0; r < bench; ++r)
+                for (int mode = 0; mode < 2; ++mode) {
+                    plan.interpret = !mode;
+                    t0 = prof_now_ns();
+                    if (fx_run(&plan, NULL) != n) { fprintf(stderr, "interpreted and specialized runs disagree\n"); return 1; }
+                    uint64_t t = prof_now_ns() - t0;
+                    if (t < best[mode]) best[mode] = t;
+                }
+            printf("interpreted %.1f ms, specialized %.1f ms (%.2fx)\n",
+                   (double)best[0] / 1e6, (double)best[1] / 1e6, (double)best[0] / (double)(best[1] ? best[1] : 1));
+        }
+        if (filter_out) {                        // matching rows as a new table, saved as CSV
+            RowVec sub;
+            fx_run(&plan, &marks);
+            t0 = prof_now_ns();
+            vec_copy_marked(&sub, &vec, &marks);
+            double ms = (double)(prof_now_ns() - t0) / 1e6;
+            int rc = write_csv(&sub, NULL, filter_out);
+            if (rc != 0) { fprintf(stderr, "%s: %s\n", filter_out, strerror(rc)); return 1; }
+            printf("%zu rows copied in %.1f ms, written to %s\n", sub.len, ms, filter_out);
+            vec_free(&sub);
+            marks_free(&marks);
+        }
+        vec_free(&vec);
+        return 0;
+    }
+
+    if (g_schema.frozen < 0) g_schema.frozen = 0;
+    schema_layout();
+    stats_sample(&tab);
+    if (tab.vec) { marks_resize(&marks, vec.len); tab.marks = &marks; }
+    if (sort_id) {
+        if (ido_build(&ido, &vec) != 0) { fprintf(stderr, "Too many rows to sort by ID\n"); return 1; }
+        tab.by_id = &ido;
+    }
+    if (serve_path) {
+        if (!tab.vec) { fprintf(stderr, "--serve needs an in-memory table\n"); return 1; }
+        snap_publish(&snap, &vec);
+        int rc = srv_start(&srv, serve_path, &snap);
+        if (rc != 0) { fprintf(stderr, "%s: %s\n", serve_path, strerror(rc)); return 1; }
+        serving = 1;
+    }
+    if (shm_name) {
+        if (!tab.vec) { fprintf(stderr, "--shm needs an in-memory table\n"); return 1; }
+        snap_publish(&snap, &vec);
+        int rc = shm_pub_open(&shm, shm_name);
+        if (rc == 0) rc = shm_pub_sync(&shm, snap.cur);
+        if (rc != 0) { fprintf(stderr, "%s: %s\n", shm_name, strerror(rc)); return 1; }
+        shm_on = 1;
+    }
 
     if (initscr() == NULL) { fprintf(stderr, "Failed to init ncurses\n"); return 1; }
     noecho();
@@ -310,82 +5332,278 @@ int main(void) {
     curs_set(0);
     start_color();
     use_default_colors();
+    tui_init(!use_ncurses);
 	
 	MemInfo mem;
-	get_mem_info(&mem);
-
-	// Pre-format text once; it will be shown in the header every frame.
 	char rss_h[32], vsz_h[32], phys_h[32], as_h[32], data_h[32], stack_h[32];
-	human_bytes(mem.rss_bytes, rss_h, sizeof(rss_h));
-	human_bytes(mem.vsize_bytes, vsz_h, sizeof(vsz_h));
-	human_bytes(mem.phys_bytes, phys_h, sizeof(phys_h));
-	format_limit(as_h, sizeof(as_h), mem.lim_as);
-	format_limit(data_h, sizeof(data_h), mem.lim_data);
-	format_limit(stack_h, sizeof(stack_h), mem.lim_stack);
+	uint64_t mem_at = 0;       // when mem was last sampled (0 = never)
 
     size_t sel = 0;            // selected row index
-    size_t col_focus = 1;      // 0=ID,1=Name,2=Status
+    size_t col_focus = 1;      // 0=ID,1=Name,2=Status, then schema extras
+    size_t first_col = 0;      // first scrolling column on screen
     size_t scroll = 0;
+    size_t prev_scroll = 0;    // to tell the prefetcher which way we move
 
     while (1) {
-        erase();
+		// Sample memory once and pre-format it for the header; with
+		// timings on, resample at most once a second.
+		if (mem_at == 0 || (g_prof_on && prof_now_ns() - mem_at >= 1000000000ull)) {
+		    uint64_t t0 = span_begin();
+		    get_mem_info(&mem);
+		    span_end(SPAN_MEMINFO, t0);
+		    mem_at = prof_now_ns();
+		    human_bytes(mem.rss_bytes, rss_h, sizeof(rss_h));
+		    human_bytes(mem.vsize_bytes, vsz_h, sizeof(vsz_h));
+		    human_bytes(mem.phys_bytes, phys_h, sizeof(phys_h));
+		    format_limit(as_h, sizeof(as_h), mem.lim_as);
+		    format_limit(data_h, sizeof(data_h), mem.lim_data);
+		    format_limit(stack_h, sizeof(stack_h), mem.lim_stack);
+		}
+
+        size_t nrows = table_len(&tab);
+        tui_erase();
 
-        int h,w; getmaxyx(stdscr, h, w);
+        int h,w; tui_size(&h, &w);
         int top = 1, left = 2;
-        int box_w = COL0_W + COL1_W + COL2_W + 6; // spaces + margins
+        schema_autosize();               // no-op unless the data changed
+        int box_w = schema_line_width(); // cells incl. spaces
         if (box_w + left + 1 > w) box_w = w - left - 1;
         int box_h = h - 2;
         if (box_h < 6) box_h = 6;
 
+        // Background export finished: join it and drop versions it held
+        if (xt.running && __atomic_load_n(&xt.done, __ATOMIC_ACQUIRE)) {
+            pthread_join(xt.th, NULL);
+            xt.running = 0;
+            if (xt.rc == 0) snprintf(xt_note, sizeof(xt_note), "CSV exported: %s", xt.path);
+            else            snprintf(xt_note, sizeof(xt_note), "CSV export failed: %s", strerror(xt.rc));
+        }
+        if (snap.retired) snap_reclaim(&snap);
+        timeout((follow || xt.running || serving) ? FOLLOW_FRAME_MS : -1);   // wake up for arrivals / completion
+
+        // Merge rows that arrived since the last frame in one batch
+        if (follow) {
+            uint64_t t0 = span_begin();
+            size_t before = vec.len, added = follow_poll(&fol, FOLLOW_BUDGET);
+            if (added) {
+                marks_resize(&marks, vec.len);
+                snap_touch(&snap, before, vec.len);
+                for (size_t i = before; i < vec.len; ++i) stats_row(&vec.data[i], &vec, i, +1);
+                if (nix.root && added > before / 8) { nix_free(&nix); nix_build(&nix, &vec); }
+                else if (nix.root) for (size_t i = before; i < vec.len; ++i) nix_insert(&nix, i);
+                ido_append(&ido, &vec, before);
+                if (tab.by_id && ido.stale) ido_build(&ido, &vec);
+                nrows = vec.len;
+                if (!follow_paused) {            // stay on the newest row
+                    sel = table_rank(&tab, vec.len - 1);
+                    if (sel < scroll) scroll = sel;
+                    if (box_h > 2 && sel >= scroll + (size_t)(box_h - 2)) scroll = sel - (size_t)(box_h - 2) + 1;
+                }
+                span_end(SPAN_FOLLOW, t0);
+            }
+        }
+
+        // Apply writes queued by socket clients, then publish for them and
+        // for the shared-memory mirror
+        if (serving) {
+            size_t nw = srv_take_writes(&srv, &wq, &wq_cap);
+            for (size_t k = 0; k < nw; ++k) {
+                size_t idx = wq[k].row;
+                if (idx >= vec.len) continue;
+                stats_row(&vec.data[idx], &vec, idx, -1);
+                memcpy(vec.data[idx].status, wq[k].status, sizeof(wq[k].status));
+                stats_row(&vec.data[idx], &vec, idx, +1);
+                snap_touch(&snap, idx, idx + 1);
+            }
+        }
+        if (serving || shm_on) snap_publish(&snap, &vec);
+        if (shm_on) shm_pub_sync(&shm, snap.cur);
+        if (tab.by_id && ido.stale) ido_build(&ido, &vec);   // rows were deleted or re-keyed
+
 /*        mvprintw(0, 2, "Interactive Table (rows: %zu)  |  Selected: %zu  |  Column: %zu", vec.len, sel, col_focus);
         draw_border(top-1, left-1, box_w+2, box_h+2);
         draw_table(&vec, sel, col_focus, scroll, top, left, box_w, box_h);*/
 		// header with memory info
 		
-		mvprintw(0, 2,
+		tui_mvprintf(0, 2,
 		    "Interactive Table (rows: %zu) | Sel:%zu Col:%zu | RSS:%s VSZ:%s | Phys:%s | AS:%s DATA:%s STACK:%s",
-		    vec.len, sel, col_focus, rss_h, vsz_h, phys_h, as_h, data_h, stack_h);
+		    nrows, sel, col_focus, rss_h, vsz_h, phys_h, as_h, data_h, stack_h);
+		if (tab.by_id) tui_printf(" | by ID");
+		else if (tab.order) tui_printf(" | by name");
+		if (marks.count) tui_printf(" | marked: %zu", marks.count);
+		if (follow) tui_printf(" | follow: %s", fol.eof ? "ended" : follow_paused ? "paused" : "live");
+		if (xt_note[0]) tui_printf(" | %s", xt_note);
+		if (dup_note[0]) tui_printf(" | %s", dup_note);
+		if (serving) tui_printf(" | serving %s (%llu req)", serve_path,
+		                    (unsigned long long)__atomic_load_n(&srv.ops, __ATOMIC_RELAXED));
+		if (schema_line_width() > box_w) {
+		    int cols[MAX_COLS], nc = col_window(first_col, box_w, cols);
+		    if (nc > 0) tui_printf(" | cols %d-%d/%d", cols[0] + 1, cols[nc-1] + 1, g_schema.ncols);
+		}
+		if (tab.pc) {
+		    tui_printf(" | %s%s cache hit:%llu miss:%llu pf:%llu", tab.pc->src->name,
+		           tab.pc->src->write ? "" : " (ro)", tab.pc->hits, tab.pc->misses, tab.pc->prefetched);
+		    if (tab.pc->wb_err) tui_printf(" | write-back failed: %s", strerror(tab.pc->wb_err));
+		}
 	        draw_border(top-1, left-1, box_w+2, box_h+2);
-	        draw_table(&vec, sel, col_focus, scroll, top, left, box_w, box_h);
+	        uint64_t t_draw = span_begin();
+	        first_col = col_scroll_fit(col_focus, first_col, box_w);
+	        draw_table(&tab, sel, col_focus, first_col, scroll, top, left, box_w, box_h);
+	        span_end(SPAN_DRAW, t_draw);
+		if (g_prof_on) draw_timings(top, (left + box_w + 46 < w) ? left + box_w + 2 : w - 44);
+		if (tab.pc && box_h > 2) {
+		    size_t last = scroll + (size_t)(box_h - 2) - 1;
+		    pc_prefetch(tab.pc, scroll, last < nrows ? last : nrows - 1, scroll < prev_scroll ? -1 : 1);
+		}
+		prev_scroll = scroll;
 		
 
-        refresh();
+        tui_refresh();
 
         int ch = getch();
-        if (ch == 'q' || ch == 'Q') break;
+        if (ch == 'q' || ch == 'Q') {
+            if (tab.pc && pc_flush(tab.pc) != 0) {   // edits stay cached; let the user retry
+                char msg[96];
+                snprintf(msg, sizeof(msg), "Saving edits failed: %s. Quit anyway? (y/n)", strerror(tab.pc->wb_err));
+                show_message_center(msg);
+                if (getch() != 'y') continue;
+            }
+            break;
+        }
+        if (ch == ERR) continue;           // follow-mode frame tick
 
         int rows_area = box_h - 2;
         if (rows_area < 1) rows_area = 1;
         size_t max_visible = (size_t)rows_area;
 
+        uint64_t t_input = span_begin();
+        g_prof_waited = 0;
         switch (ch) {
             case KEY_UP: case 'k':
                 if (sel > 0) sel--;
                 if (sel < scroll) scroll = sel;
                 break;
             case KEY_DOWN: case 'j':
-                if (vec.len == 0) break;
-                if (sel + 1 < vec.len) sel++;
+                if (nrows == 0) break;
+                if (sel + 1 < nrows) sel++;
+                if (sel >= scroll + max_visible) scroll = sel - max_visible + 1;
+                break;
+            case KEY_PPAGE:
+                sel = (sel > max_visible) ? sel - max_visible : 0;
+                if (sel < scroll) scroll = sel;
+                break;
+            case KEY_NPAGE:
+                if (nrows == 0) break;
+                sel = (sel + max_visible < nrows) ? sel + max_visible : nrows - 1;
+                if (sel >= scroll + max_visible) scroll = sel - max_visible + 1;
+                break;
+            case KEY_HOME:
+                sel = 0; scroll = 0;
+                break;
+            case KEY_END:
+                if (nrows == 0) break;
+                sel = nrows - 1;
                 if (sel >= scroll + max_visible) scroll = sel - max_visible + 1;
                 break;
             case KEY_LEFT: case 'h':
                 if (col_focus > 0) col_focus--;
                 break;
             case KEY_RIGHT: case 'l':
-                if (col_focus + 1 < MAX_COLS) col_focus++;
+                if (col_focus + 1 < (size_t)g_schema.ncols) col_focus++;
                 break;
             case 10: // Enter
-            case ' ': // Space
-                if (vec.len > 0 && sel < vec.len) show_details(&vec.data[sel]);
-                break;
+            case ' ': { // Space
+                const Row* r = (sel < nrows) ? table_row(&tab, sel) : NULL;
+                if (r) show_details(r, tab.vec, table_index(&tab, sel));
+            } break;
             case 'e':
             case 'E':
-                if (vec.len > 0 && sel < vec.len) {
-                    edit_cell(&vec.data[sel], col_focus, top+box_h+1, left);
+                if (tab.vec && sel < vec.len && g_schema.col[col_focus].field == FIELD_EXTRA) {
+                    size_t idx = table_index(&tab, sel);
+                    stats_row(&vec.data[idx], &vec, idx, -1);
+                    int rc = edit_extra(&vec, idx, col_focus, top+box_h+1, left);
+                    stats_row(&vec.data[idx], &vec, idx, +1);
+                    if (rc != 0) {
+                        show_message_center("Not a valid number");
+                        getch();
+                    }
+                } else if (tab.vec && sel < vec.len) {
+                    size_t idx = table_index(&tab, sel);
+                    Row r = vec.data[idx];
+                    edit_cell(&r, col_focus, top+box_h+1, left);
+                    uint64_t t0 = span_begin();
+                    stats_row(&vec.data[idx], &vec, idx, -1);
+                    int id_changed = r.id != vec.data[idx].id;
+                    if (nix.root && strcmp(r.name, vec.data[idx].name) != 0) {
+                        nix_erase(&nix, idx);
+                        vec.data[idx] = r;
+                        nix_insert(&nix, idx);
+                        if (tab.order) sel = nix_rank_of(&nix, idx);   // follow the row
+                    } else {
+                        vec.data[idx] = r;
+                    }
+                    if (id_changed) {
+                        ido.stale = 1;
+                        if (tab.by_id && ido_build(&ido, &vec) == 0) sel = ido_rank(&ido, idx);   // follow the row
+                    }
+                    stats_row(&vec.data[idx], &vec, idx, +1);
+                    snap_touch(&snap, idx, idx + 1);
+                    span_end(SPAN_EDIT, t0);
+                } else if (tab.pc && sel < nrows && g_schema.col[col_focus].field != FIELD_EXTRA) {
+                    const Row* cur = table_row(&tab, sel);
+                    if (!cur) break;
+                    Row old = *cur, r = *cur;
+                    edit_cell(&r, col_focus, top+box_h+1, left);
+                    uint64_t t0 = span_begin();
+                    int rc = pc_write(tab.pc, sel, &r);
+                    if (rc == 0) { stats_row(&old, NULL, sel, -1); stats_row(&r, NULL, sel, +1); }
+                    span_end(SPAN_EDIT, t0);
+                    if (rc != 0) { show_message_center("Source is read-only"); getch(); }
                 }
                 break;
+            case 'x':
+            case 'X': {
+                if (!tab.vec) { show_message_center("Export works on in-memory tables"); getch(); break; }
+                if (xt.running) { show_message_center("An export is still running"); getch(); break; }
+                if (!vec.nextra) {                     // in the background, from a snapshot
+                    snap_publish(&snap, &vec);
+                    default_export_path(xt.path, sizeof(xt.path));
+                    xt.st = &snap;
+                    xt.done = 0;
+                    if (pthread_create(&xt.th, NULL, export_task_main, &xt) == 0) {
+                        xt.running = 1;
+                        snprintf(xt_note, sizeof(xt_note), "exporting %s", xt.path);
+                        break;
+                    }
+                }
+                char path[128], msg[256];
+                default_export_path(path, sizeof(path));
+                uint64_t t0 = span_begin();
+                int rc = write_csv(&vec, NULL, path);
+                span_end(SPAN_EXPORT, t0);
+                if (rc == 0) snprintf(msg, sizeof(msg), "CSV exported: %s", path);
+                else         snprintf(msg, sizeof(msg), "CSV export failed: %s", strerror(rc));
+                show_message_center(msg);
+                getch();
+            } break;
+            case 'w':
+            case 'W': {
+                if (!tab.vec) { show_message_center("Already a paged .itb/generated source"); getch(); break; }
+                char path[128] = "";
+                if (prompt_line_input(top+box_h+1, left, (int)sizeof(path)-1, "Save as (.itb/.itz): ", path, sizeof(path)) != 0 || !path[0]) break;
+                char msg[256];
+                uint64_t t0 = span_begin();
+                int rc = has_suffix(path, ".itz") ? write_itz(&vec, path) : write_itb(&vec, path);
+                span_end(SPAN_SAVE, t0);
+                if (rc == 0) snprintf(msg, sizeof(msg), "Saved %zu rows to %s%s", vec.len, path,
+                                      vec.nextra ? " (ID/Name/Status only)" : "");
+                else         snprintf(msg, sizeof(msg), "Save failed: %s", strerror(rc));
+                show_message_center(msg);
+                getch();
+            } break;
             case 'a':
             case 'A': {
+                if (!tab.vec) { show_message_center("Paged sources cannot add rows"); getch(); break; }
                 Row r;
                 r.id = (int)(vec.len ? vec.data[vec.len-1].id + 1 : 1);
                 strncpy(r.name, "New Item", sizeof(r.name));
@@ -393,24 +5611,211 @@ int main(void) {
                 strncpy(r.status, "Pending", sizeof(r.status));
                 r.status[sizeof(r.status)-1]='\0';
                 vec_push(&vec, r);
-                sel = vec.len ? vec.len-1 : 0;
-                if (sel >= scroll + max_visible) scroll = sel - max_visible + 1;
+                marks_resize(&marks, vec.len);
+                snap_touch(&snap, vec.len-1, vec.len);
+                stats_row(&r, &vec, vec.len-1, +1);
+                if (nix.root) nix_insert(&nix, vec.len-1);
+                ido_append(&ido, &vec, vec.len-1);
+                if (tab.by_id && ido.stale) ido_build(&ido, &vec);
+                sel = table_rank(&tab, vec.len-1);
             } break;
             case 'd':
             case 'D':
-                if (vec.len > 0 && sel < vec.len) {
-                    vec_erase(&vec, sel);
+                if (!tab.vec) { show_message_center("Paged sources cannot delete rows"); getch(); break; }
+                if (marks.count) {
+                    char msg[64];
+                    snprintf(msg, sizeof(msg), "Delete %zu marked rows? (y/n)", marks.count);
+                    show_message_center(msg);
+                    if (getch() != 'y') break;
+                    uint64_t t0 = span_begin();
+                    snap_touch(&snap, marks_first(&marks), (size_t)-1);
+                    vec_delete_marked(&vec, &marks);
+                    if (nix.root) { nix_free(&nix); nix_build(&nix, &vec); }
+                    ido.stale = 1;
+                    stats_sample(&tab);
+                    span_end(SPAN_EDIT, t0);
+                    if (sel >= vec.len) sel = vec.len ? vec.len - 1 : 0;
+                } else if (vec.len > 0 && sel < vec.len) {
+                    size_t idx = table_index(&tab, sel);
+                    if (nix.root) nix_erase(&nix, idx);
+                    stats_row(&vec.data[idx], &vec, idx, -1);
+                    vec_erase(&vec, idx);
+                    marks_erase(&marks, idx);
+                    ido.stale = 1;
+                    snap_touch(&snap, idx, (size_t)-1);
+                    if (nix.root) nix_shift_rows(nix.root, idx);
                     if (sel >= vec.len && sel > 0) sel--;
-                    if (scroll > sel) scroll = sel;
                 }
                 break;
+            case 'i': {                 // find duplicate IDs, then pick what to keep
+                if (!tab.vec) { show_message_center("Paged sources cannot remove duplicates"); getch(); break; }
+                DedupStats ds;
+                char msg[128];
+                if (vec_dedup(&vec, DEDUP_CHECK, &ds) != 0) { show_message_center("Too many rows to check"); getch(); break; }
+                dup_note[0] = '\0';
+                if (!ds.rows) { show_message_center("No duplicate IDs"); getch(); break; }
+                snprintf(msg, sizeof(msg), "%zu rows repeat %zu IDs. Keep (f)irst, (l)ast or (m)erge?", ds.rows, ds.ids);
+                show_message_center(msg);
+                int k = getch();
+                int policy = k == 'f' ? DEDUP_FIRST : k == 'l' ? DEDUP_LAST : k == 'm' ? DEDUP_MERGE : -1;
+                if (policy < 0) break;
+                uint64_t t0 = span_begin();
+                snap_touch(&snap, 0, (size_t)-1);
+                vec_dedup(&vec, policy, &ds);
+                ido.stale = 1;
+                marks_clear(&marks);             // row positions moved
+                marks_resize(&marks, vec.len);
+                if (nix.root) { nix_free(&nix); nix_build(&nix, &vec); }
+                stats_sample(&tab);
+                span_end(SPAN_EDIT, t0);
+                if (sel >= vec.len) sel = vec.len ? vec.len - 1 : 0;
+            } break;
+            case 'm':
+                if (!tab.marks) { show_message_center("Marks need an in-memory table"); getch(); break; }
+                if (sel < vec.len) {
+                    size_t idx = table_index(&tab, sel);
+                    marks_set(&marks, idx, !marks_get(&marks, idx));
+                    if (sel + 1 < nrows) sel++;
+                }
+                break;
+            case KEY_SR: case 'K':      // shift+move marks the rows passed over
+            case KEY_SF: case 'J':
+                if (!tab.marks) { show_message_center("Marks need an in-memory table"); getch(); break; }
+                if (sel >= vec.len) break;
+                marks_set(&marks, table_index(&tab, sel), 1);
+                if (ch == KEY_SR || ch == 'K') { if (sel > 0) sel--; }
+                else if (sel + 1 < nrows) sel++;
+                marks_set(&marks, table_index(&tab, sel), 1);
+                break;
+            case 'M':
+                marks_clear(&marks);
+                break;
+            case 'f':
+            case 'F': {
+                if (!tab.marks) { show_message_center("Marks need an in-memory table"); getch(); break; }
+                char expr[160] = "";
+                FxPlan plan;
+                if (prompt_line_input(top+box_h+1, left, (int)sizeof(expr)-1, "Mark where: ", expr, sizeof(expr)) != 0 || !expr[0]) break;
+                if (fx_compile(&plan, &vec, expr) != 0) { show_message_center(plan.err); getch(); break; }
+                uint64_t t0 = span_begin();
+                fx_run(&plan, &marks);
+                span_end(SPAN_EDIT, t0);
+            } break;
+            case 's':
+            case 'S':
+            case 'c':
+            case 'C': {
+                char status[32] = "", prompt[64];
+                const Row* cur = (sel < nrows) ? table_row(&tab, sel) : NULL;
+                if (!cur) break;
+                int cycle = (ch == 'c' || ch == 'C');
+                if (cycle) {
+                    snprintf(status, sizeof(status), "%s", status_next(cur->status));
+                } else {
+                    snprintf(prompt, sizeof(prompt), marks.count ? "Status for %zu marked rows: " : "Status: ", marks.count);
+                    if (prompt_line_input(top+box_h+1, left, (int)sizeof(status)-1, prompt, status, sizeof(status)) != 0 || !status[0]) break;
+                }
+                uint64_t t0 = span_begin();
+                if (marks.count && !cycle) {
+                    vec_set_status_marked(&vec, &marks, status);
+                    marks_touch(&marks, &snap);
+                    stats_sample(&tab);
+                } else if (tab.vec) {
+                    Row* r = &vec.data[table_index(&tab, sel)];
+                    stats_row(r, &vec, table_index(&tab, sel), -1);
+                    snprintf(r->status, sizeof(r->status), "%s", status);
+                    stats_row(r, &vec, table_index(&tab, sel), +1);
+                    snap_touch(&snap, table_index(&tab, sel), table_index(&tab, sel) + 1);
+                } else {
+                    Row old = *cur, r = *cur;
+                    snprintf(r.status, sizeof(r.status), "%s", status);
+                    if (pc_write(tab.pc, sel, &r) == 0) { stats_row(&old, NULL, sel, -1); stats_row(&r, NULL, sel, +1); }
+                    else { show_message_center("Source is read-only"); getch(); }
+                }
+                span_end(SPAN_EDIT, t0);
+            } break;
+            case 'n':
+            case 'N': {
+                if (!tab.vec) { show_message_center("Name order needs an in-memory table"); getch(); break; }
+                size_t idx = table_index(&tab, sel);
+                if (!nix.root) nix_build(&nix, &vec);
+                tab.order = tab.order ? NULL : &nix;
+                tab.by_id = NULL;
+                if (idx < vec.len) sel = tab.order ? nix_rank_of(&nix, idx) : idx;
+            } break;
+            case 'o':
+            case 'O': {
+                if (!tab.vec) { show_message_center("ID order needs an in-memory table"); getch(); break; }
+                size_t idx = table_index(&tab, sel);
+                if (tab.by_id) tab.by_id = NULL;
+                else if ((ido.stale || ido.len != vec.len) && ido_build(&ido, &vec) != 0) {
+                    show_message_center("Too many rows to sort by ID"); getch(); break;
+                } else {
+                    tab.by_id = &ido;
+                    tab.order = NULL;
+                }
+                if (idx < vec.len) sel = tab.by_id ? ido_rank(&ido, idx) : idx;
+            } break;
+            case '/': {
+                if (!tab.vec) { show_message_center("Name order needs an in-memory table"); getch(); break; }
+                char prefix[64] = "";
+                if (prompt_line_input(top+box_h+1, left, (int)sizeof(prefix)-1, "Jump to name: ", prefix, sizeof(prefix)) != 0 || !prefix[0]) break;
+                if (!nix.root) nix_build(&nix, &vec);
+                tab.order = &nix;
+                tab.by_id = NULL;
+                size_t pos = nix_seek(&nix, prefix);
+                if (pos < vec.len && nix_has_prefix(vec.data[nix_row_at(&nix, pos)].name, prefix)) sel = pos;
+                else { show_message_center("No name starts with that prefix"); getch(); }
+            } break;
+            case 'p':
+            case 'P':
+                if (!follow) break;
+                follow_paused = !follow_paused;
+                if (!follow_paused && nrows) {
+                    if (tab.by_id && ido.stale) ido_build(&ido, &vec);
+                    sel = table_rank(&tab, vec.len - 1);
+                }
+                break;
+            case 't':
+            case 'T':
+                g_prof_on = !g_prof_on;
+                break;
+            case 'u':
+            case 'U': {
+                char path[128], msg[256];
+                default_timings_path(path, sizeof(path));
+                int rc = write_timings(path);
+                if (rc == 0) snprintf(msg, sizeof(msg), "Timings written: %s", path);
+                else         snprintf(msg, sizeof(msg), "Timings dump failed: %s", strerror(rc));
+                show_message_center(msg);
+                getch();
+            } break;
             default:
                 // ignore
                 break;
         }
+        // keep the selection on screen after jumps and re-sorts
+        if (sel < scroll) scroll = sel;
+        if (sel >= scroll + max_visible) scroll = sel - max_visible + 1;
+        if (!g_prof_waited) span_end(SPAN_INPUT, t_input);   // skip spans spent waiting on a prompt
     }
 
     endwin();
+    if (xt.running) pthread_join(xt.th, NULL);
+    if (serving) srv_stop(&srv);
+    if (shm_on) shm_pub_close(&shm);
+    free(wq);
+    snap_destroy(&snap);
+    nix_free(&nix);
+    ido_free(&ido);
+    marks_free(&marks);
+    if (follow) follow_close(&fol);
+    int rc = 0;
+    if (tab.pc) {
+        const char* src_name = tab.pc->src->name;
+        int err = pc_close(tab.pc);
+        if (err) { fprintf(stderr, "Edits not written to %s: %s\n", src_name, strerror(err)); rc = 1; }
+    }
     vec_free(&vec);
-    return 0;
+    return rc;
 }
@@ -0,0 +1,184 @@
+// itable_shm.h
+// Layout of the shared-memory table that `itable --shm NAME` publishes,
+// plus a small header-only reader. Readers map the segment read-only and
+// read rows straight out of it: no syscalls and no copies per row.
+//
+// Segment layout (all offsets from the start of the segment):
+//
+//   [0, ITSHM_HEADER)        ItShmHeader
+//   id_off                   int32_t id[capacity]
+//   name_off                 char    name[capacity][ITSHM_NAME]
+//   status_off               char    status[capacity][ITSHM_STATUS]
+//
+// Strings are NUL padded to their width. Only rows [0, rows) are valid.
+//
+// Consistency is a seqlock: the writer makes `seq` odd, updates columns
+// and header, then makes it even again. A reader samples `seq`, reads,
+// and retries if `seq` was odd or has changed. When the table outgrows
+// the segment, the writer enlarges it, moves the columns and bumps
+// `generation`; readers then remap (itshm_read_row does this itself).
+// If the writer dies inside a write section, `seq` stays odd and readers
+// spin forever; a reader that must not hang has to check that the writer
+// is alive before reading.
+//
+// Usage:
+//   ItShmReader r;
+//   if (itshm_open(&r, "/itable") == 0) {
+//       ItShmRow row;
+//       if (itshm_read_row(&r, 0, &row) == 0) printf("%d %s\n", row.id, row.name);
+//       itshm_close(&r);
+//   }
+// Link with -lrt on glibc older than 2.34.
+
+#ifndef ITABLE_SHM_H
+#define ITABLE_SHM_H
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define ITSHM_MAGIC   "ITSHM1"
+#define ITSHM_HEADER  4096          /* bytes before the first column */
+#define ITSHM_NAME    64
+#define ITSHM_STATUS  32
+
+typedef struct {
+    char     magic[8];              /* ITSHM_MAGIC, NUL padded */
+    uint64_t seq;                   /* odd while the writer is updating */
+    uint64_t generation;            /* bumped when the layout changes */
+    uint64_t size;                  /* segment bytes */
+    uint64_t rows;                  /* valid rows */
+    uint64_t capacity;              /* rows the columns have room for */
+    uint64_t id_off, name_off, status_off;
+    uint64_t version;               /* table version last published */
+    uint64_t writer_pid;            /* publishing process; 0 after a clean close */
+} ItShmHeader;
+
+typedef struct {
+    int32_t id;
+    char    name[ITSHM_NAME];
+    char    status[ITSHM_STATUS];
+} ItShmRow;
+
+typedef struct {
+    int                 fd;
+    const unsigned char* base;
+    size_t              size;       /* bytes mapped */
+    uint64_t            generation; /* layout the cached offsets belong to */
+    uint64_t            capacity, id_off, name_off, status_off;
+} ItShmReader;
+
+static inline const ItShmHeader* itshm_header(const ItShmReader* r) {
+    return (const ItShmHeader*)r->base;
+}
+
+/* Start / validate a read section. Spins while the writer is active, and
+   forever if the writer died mid-update (see the note at the top). */
+static inline uint64_t itshm_read_begin(const ItShmReader* r) {
+    uint64_t s;
+    while ((s = __atomic_load_n(&itshm_header(r)->seq, __ATOMIC_ACQUIRE)) & 1) { }
+    return s;
+}
+
+static inline int itshm_read_retry(const ItShmReader* r, uint64_t seq) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&itshm_header(r)->seq, __ATOMIC_RELAXED) != seq;
+}
+
+/* (Re)map the segment at its current size and cache the layout.
+   Returns 0, or -1 if the segment is not a valid itable table. */
+static inline int itshm_remap(ItShmReader* r) {
+    for (;;) {
+        const ItShmHeader* h = itshm_header(r);
+        uint64_t seq = itshm_read_begin(r);
+        uint64_t size = h->size, gen = h->generation;
+        uint64_t cap = h->capacity, id = h->id_off, name = h->name_off, status = h->status_off;
+        if (itshm_read_retry(r, seq)) continue;
+        if (size > r->size) {
+            void* p = mmap(NULL, (size_t)size, PROT_READ, MAP_SHARED, r->fd, 0);
+            if (p == MAP_FAILED) return -1;
+            munmap((void*)r->base, r->size);
+            r->base = (const unsigned char*)p;
+            r->size = (size_t)size;
+        }
+        if (id + cap * 4 > r->size || name + cap * ITSHM_NAME > r->size || status + cap * ITSHM_STATUS > r->size)
+            return -1;
+        r->generation = gen;
+        r->capacity = cap;
+        r->id_off = id;
+        r->name_off = name;
+        r->status_off = status;
+        return 0;
+    }
+}
+
+static inline int itshm_open(ItShmReader* r, const char* name) {
+    struct stat st;
+    memset(r, 0, sizeof(*r));
+    r->fd = shm_open(name, O_RDONLY, 0);
+    if (r->fd < 0) return -1;
+    if (fstat(r->fd, &st) != 0 || (size_t)st.st_size < ITSHM_HEADER) { close(r->fd); return -1; }
+    void* p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, r->fd, 0);
+    if (p == MAP_FAILED) { close(r->fd); return -1; }
+    r->base = (const unsigned char*)p;
+    r->size = (size_t)st.st_size;
+    if (memcmp(itshm_header(r)->magic, ITSHM_MAGIC, sizeof(ITSHM_MAGIC)) != 0 || itshm_remap(r) != 0) {
+        munmap(p, r->size);
+        close(r->fd);
+        return -1;
+    }
+    return 0;
+}
+
+static inline void itshm_close(ItShmReader* r) {
+    if (r->base) munmap((void*)r->base, r->size);
+    if (r->fd >= 0) close(r->fd);
+    r->base = NULL;
+    r->fd = -1;
+}
+
+/* Column pointers for row i; only valid inside a read section. */
+static inline const int32_t* itshm_id(const ItShmReader* r, uint64_t i) {
+    return (const int32_t*)(r->base + r->id_off) + i;
+}
+static inline const char* itshm_name(const ItShmReader* r, uint64_t i) {
+    return (const char*)r->base + r->name_off + i * ITSHM_NAME;
+}
+static inline const char* itshm_status(const ItShmReader* r, uint64_t i) {
+    return (const char*)r->base + r->status_off + i * ITSHM_STATUS;
+}
+
+/* Rows currently published */
+static inline uint64_t itshm_rows(ItShmReader* r) {
+    for (;;) {
+        uint64_t seq = itshm_read_begin(r);
+        uint64_t n = itshm_header(r)->rows;
+        if (!itshm_read_retry(r, seq)) return n;
+    }
+}
+
+/* Copy out row i consistently. Returns 0, or -1 if there is no row i. */
+static inline int itshm_read_row(ItShmReader* r, uint64_t i, ItShmRow* out) {
+    for (;;) {
+        uint64_t seq = itshm_read_begin(r);
+        const ItShmHeader* h = itshm_header(r);
+        if (h->generation != r->generation) {
+            if (itshm_read_retry(r, seq)) continue;
+            if (itshm_remap(r) != 0) return -1;
+            continue;
+        }
+        if (i >= h->rows || i >= r->capacity) {
+            if (itshm_read_retry(r, seq)) continue;
+            return -1;
+        }
+        out->id = *itshm_id(r, i);
+        memcpy(out->name, itshm_name(r, i), ITSHM_NAME);
+        memcpy(out->status, itshm_status(r, i), ITSHM_STATUS);
+        if (!itshm_read_retry(r, seq)) return 0;
+    }
+}
+
+#endif /* ITABLE_SHM_H */